@@ -0,0 +1,68 @@
+#ifndef CONCURRENT_DISJOINT_SET_H
+#define CONCURRENT_DISJOINT_SET_H
+
+#include <atomic>
+#include <vector>
+#include <utility>
+
+// Lock-free union-find over the dense indices [0, n). `merge' and `find' can
+// be called from any number of threads at once. Roots are always linked under
+// the smaller root so parent indices only ever decrease, which keeps path
+// splitting safe under concurrent updates and makes the root of every set its
+// smallest element.
+class concurrent_disjoint_set {
+  public:
+  explicit concurrent_disjoint_set(size_t n) : _parent(n) {
+    for (size_t i = 0; i < n; i++)
+      _parent[i].store(i, std::memory_order_relaxed);
+  }
+
+  size_t size() const { return _parent.size(); }
+
+  size_t find(size_t i) {
+    size_t p = _parent[i].load(std::memory_order_acquire);
+    while (p != i) {
+      size_t gp = _parent[p].load(std::memory_order_acquire);
+      // path splitting: point i at its grandparent. If the exchange fails,
+      // another thread has already moved i closer to the root. The walk goes
+      // on from the loaded p and gp either way, since they stay on the path
+      // to the root.
+      if (gp != p) {
+        size_t expected = p;
+        _parent[i].compare_exchange_weak(expected, gp,
+            std::memory_order_release, std::memory_order_relaxed);
+      }
+      i = p;
+      p = gp;
+    }
+    return i;
+  }
+
+  // returns true if a and b were in different sets
+  bool merge(size_t a, size_t b) {
+    while (true) {
+      a = find(a);
+      b = find(b);
+      if (a == b)
+        return false;
+      if (a < b)
+        std::swap(a, b);
+
+      // a is the larger root. It might have been linked by another thread
+      // since find(), in which case retry from the new roots.
+      size_t expected = a;
+      if (_parent[a].compare_exchange_strong(expected, b,
+            std::memory_order_acq_rel, std::memory_order_relaxed))
+        return true;
+    }
+  }
+
+  // smallest index in the set containing i. Only stable when no merge is
+  // running concurrently.
+  size_t component_id(size_t i) { return find(i); }
+
+  private:
+  std::vector<std::atomic<size_t>> _parent;
+};
+
+#endif /* CONCURRENT_DISJOINT_SET_H */
@@ -1,4 +1,5 @@
 #include <functional>
+#include <memory>
 
 template <class VertT, class TimeT>
 bool adjacent(
@@ -45,21 +46,27 @@ class event_graph {
   using TimeType = typename EdgeT::TimeType;
   using VertexType = typename EdgeT::VertexType;
 
-  event_graph() = default;
+  event_graph() : _index(std::make_shared<incidence_index>()) {}
   event_graph(std::vector<EdgeT> events,
       TimeType expected_dt,
       std::function<double(const EdgeT& a, const EdgeT& b, TimeType dt)> prob,
       bool deterministic,
       size_t seed) :
-    seed(seed), _topo(events), _expected_dt(expected_dt),
+    seed(seed), _expected_dt(expected_dt),
     _deterministic(deterministic), prob(prob) {
 
-    std::sort(_topo.begin(), _topo.end());
-    auto last = std::unique(_topo.begin(), _topo.end());
-    _topo.erase(last, _topo.end());
-    _topo.shrink_to_fit();
+    auto index = std::make_shared<incidence_index>();
+    auto& topo = index->topo;
+    auto& inc_in_map = index->in;
+    auto& inc_out_map = index->out;
 
-    for (const auto& e: _topo) {
+    topo = std::move(events);
+    std::sort(topo.begin(), topo.end());
+    auto last = std::unique(topo.begin(), topo.end());
+    topo.erase(last, topo.end());
+    topo.shrink_to_fit();
+
+    for (const auto& e: topo) {
       // TODO: this won't work for hypergraph events
       for (auto&& v: e.mutator_verts())
         inc_out_map[v].push_back(e);
@@ -90,11 +97,166 @@ class event_graph {
             return std::make_pair(e1.time, e1) < std::make_pair(e2.time, e2);
           });
     }
+
+    index->vertex_ids.reserve(inc_in_map.size());
+    for (auto&& inc_map: {&inc_in_map, &inc_out_map})
+      for (auto&& p: *inc_map)
+        index->vertex_ids.emplace(p.first, index->vertex_ids.size());
+
+    _index = index;
+  }
+
+  // The same event graph with a different expected (or maximum) dt. Events and
+  // incidence lists do not depend on dt, so they are shared with this graph
+  // instead of being rebuilt.
+  event_graph with_expected_dt(TimeType expected_dt) const {
+    event_graph other(*this);
+    other._expected_dt = expected_dt;
+    other.update_reduction();
+    return other;
+  }
+
+  // The same event graph whose successors() and predecessors() leave out the
+  // links dropped by reduced_successors(). Reachability between events is
+  // unchanged. Only has an effect on deterministic directed and delayed
+  // graphs, undirected ones already use the just_first shortcut. The reduced
+  // links are computed once here, so that sweeps over the reduced graph do
+  // not repeat the reduction for every event and predecessor.
+  event_graph with_transitive_reduction(bool reduce=true) const {
+    event_graph other(*this);
+    other._transitive_reduction = reduce;
+    other.update_reduction();
+    return other;
+  }
+
+  bool transitive_reduction() const {
+    return enable_transitive_reduction && _deterministic &&
+      _transitive_reduction;
   }
 
   std::vector<EdgeT> predecessors(const EdgeT& e, bool just_first=false) const {
-    std::vector<EdgeT> pred;
+    if (!transitive_reduction())
+      return adjacent_predecessors(e, just_first);
+    if (!just_first)
+      return _reduced->predecessors(event_index(e));
+
+    auto pred = adjacent_predecessors(e, just_first);
+    pred.erase(std::remove_if(pred.begin(), pred.end(),
+          [this, &e](const EdgeT& p) {
+            size_t i = event_index(p);
+            auto first = _reduced->succ.begin() +
+              (std::ptrdiff_t)_reduced->succ_offsets[i];
+            auto last = _reduced->succ.begin() +
+              (std::ptrdiff_t)_reduced->succ_offsets[i+1];
+            return !std::binary_search(first, last, e);
+          }), pred.end());
+    return pred;
+  }
+
+  std::vector<EdgeT> successors(const EdgeT& e, bool just_first=false) const {
+    if (!transitive_reduction())
+      return adjacent_successors(e, just_first);
+    if (!just_first)
+      return _reduced->successors(event_index(e));
+    return reduced_successors(e, adjacent_successors(e, just_first));
+  }
+
+  void remove_events(const std::unordered_set<EdgeT>& events) {
+    // copy on write, the index might be shared with other graphs
+    auto index = std::make_shared<incidence_index>(*_index);
+    for (auto&& inc_map: {&index->in, &index->out})
+      for (auto&& p: *inc_map)
+        p.second.erase(
+            std::remove_if(p.second.begin(), p.second.end(),
+              [&events](const EdgeT& e) {
+              return events.find(e) != events.end();
+              }),
+            p.second.end());
+    _index = index;
+    update_reduction();
+  };
+
+  const std::vector<EdgeT>& topo() const { return _index->topo; }
+  TimeType expected_dt() const { return _expected_dt; }
+  bool deterministic() const { return _deterministic; }
+
+  size_t event_count() const { return _index->topo.size(); }
+  size_t node_count() const { return _index->in.size(); }
+
+  // position of event `e' in topo()
+  size_t event_index(const EdgeT& e) const {
+    const auto& topo = _index->topo;
+    return (size_t)std::distance(topo.begin(),
+        std::lower_bound(topo.begin(), topo.end(), e));
+  }
+
+  // dense id in [0, vertex_count()) of every vertex mutated or mutating
+  // an event
+  size_t vertex_index(const VertexType& v) const {
+    return _index->vertex_ids.at(v);
+  }
+  size_t vertex_count() const { return _index->vertex_ids.size(); }
+
+  // events mutating each vertex, sorted by time
+  const std::unordered_map<VertexType, std::vector<EdgeT>>&
+  out_incidence() const { return _index->out; }
+
+  // events mutated by each vertex, sorted by effect time
+  const std::unordered_map<VertexType, std::vector<EdgeT>>&
+  in_incidence() const { return _index->in; }
+  std::pair<TimeType, TimeType> time_window() {
+    if (_index->topo.empty())
+      return std::make_pair(0, 0);
+    else
+      return std::make_pair(_index->topo.front().time,
+          _index->topo.back().time);
+  }
+
+  private:
+
+  struct incidence_index {
+    std::vector<EdgeT> topo;
+    std::unordered_map<VertexType, std::vector<EdgeT>> in, out;
+    std::unordered_map<VertexType, size_t> vertex_ids;
+  };
+
+  // successors and predecessors of the transitive reduction. Links of the
+  // event with event_index() i are in [offsets[i], offsets[i+1]).
+  struct reduced_index {
+    std::vector<size_t> succ_offsets, pred_offsets;
+    std::vector<EdgeT> succ, pred;
+
+    std::vector<EdgeT> successors(size_t i) const {
+      return std::vector<EdgeT>(
+          succ.begin() + (std::ptrdiff_t)succ_offsets[i],
+          succ.begin() + (std::ptrdiff_t)succ_offsets[i+1]);
+    }
+
+    std::vector<EdgeT> predecessors(size_t i) const {
+      return std::vector<EdgeT>(
+          pred.begin() + (std::ptrdiff_t)pred_offsets[i],
+          pred.begin() + (std::ptrdiff_t)pred_offsets[i+1]);
+    }
+  };
+
+  size_t seed;
+  std::shared_ptr<const incidence_index> _index;
+  std::shared_ptr<const reduced_index> _reduced;
+  TimeType _expected_dt;
+  bool _deterministic;
+  bool _transitive_reduction = false;
 
+  std::function<double(const EdgeT& a, const EdgeT& b, TimeType dt)> prob;
+
+  size_t combine_hash(const size_t s, const EdgeT& other) const {
+    return s ^ (std::hash<EdgeT>{}(other) + 0x9E3779B97F4A7C15 +
+        (s<<6) + (s>>2));
+  }
+
+  // links of the event graph before any transitive reduction
+  std::vector<EdgeT>
+  adjacent_predecessors(const EdgeT& e, bool just_first) const {
+    std::vector<EdgeT> pred;
     pred.reserve(e.mutator_verts().size());
 
     for (auto&& v : e.mutator_verts()) {
@@ -104,7 +266,7 @@ class event_graph {
       pred.reserve(pred.size()+res.size());
       std::sort(res.begin(), res.end());
       std::copy(
-          res.rbegin(), res.rend(),
+          res.begin(), res.end(),
           std::back_inserter(pred));
       std::inplace_merge(pred.begin(), pred.begin()+middle_offset, pred.end());
     }
@@ -114,7 +276,8 @@ class event_graph {
     return pred;
   }
 
-  std::vector<EdgeT> successors(const EdgeT& e, bool just_first=false) const {
+  std::vector<EdgeT>
+  adjacent_successors(const EdgeT& e, bool just_first) const {
     std::vector<EdgeT> succ;
 
     succ.reserve(e.mutated_verts().size());
@@ -134,45 +297,42 @@ class event_graph {
     succ.erase(std::unique(succ.begin(), succ.end()), succ.end());
 
     return succ;
- }
-
-  void remove_events(const std::unordered_set<EdgeT>& events) {
-    for (auto&& inc_map: {inc_in_map, inc_out_map})
-      for (auto&& p: inc_map)
-        p.second.erase(
-            std::remove_if(p.second.begin(), p.second.end(),
-              [&events](const EdgeT& e) {
-              return events.find(e) != events.end();
-              }),
-            p.second.end());
-  };
-
-  const std::vector<EdgeT>& topo() const { return _topo; }
-  TimeType expected_dt() const { return _expected_dt; }
-  bool deterministic() const { return _deterministic; }
-
-  size_t event_count() const { return _topo.size(); }
-  size_t node_count() const { return inc_in_map.size(); }
-  std::pair<TimeType, TimeType> time_window() {
-    if (_topo.empty())
-      return std::make_pair(0, 0);
-    else
-      return std::make_pair(_topo.front().time, _topo.back().time);
   }
 
-  private:
+  void update_reduction() {
+    if (!transitive_reduction()) {
+      _reduced = nullptr;
+      return;
+    }
 
-  size_t seed;
-  std::vector<EdgeT> _topo;
-  std::unordered_map<VertexType, std::vector<EdgeT>> inc_in_map, inc_out_map;
-  TimeType _expected_dt;
-  bool _deterministic;
+    const auto& topo = _index->topo;
+    auto reduced = std::make_shared<reduced_index>();
+    auto& succ_offsets = reduced->succ_offsets;
+    auto& pred_offsets = reduced->pred_offsets;
+
+    succ_offsets.reserve(topo.size() + 1);
+    succ_offsets.push_back(0);
+    pred_offsets.assign(topo.size() + 1, 0);
+    for (const auto& e: topo) {
+      auto succ = reduced_successors(e, adjacent_successors(e, false));
+      for (auto&& s: succ)
+        pred_offsets[event_index(s) + 1]++;
+      reduced->succ.insert(reduced->succ.end(), succ.begin(), succ.end());
+      succ_offsets.push_back(reduced->succ.size());
+    }
+    reduced->succ.shrink_to_fit();
 
-  std::function<double(const EdgeT& a, const EdgeT& b, TimeType dt)> prob;
+    for (size_t i = 0; i < topo.size(); i++)
+      pred_offsets[i+1] += pred_offsets[i];
 
-  size_t combine_hash(const size_t s, const EdgeT& other) const {
-    return s ^ (std::hash<EdgeT>{}(other) + 0x9E3779B97F4A7C15 +
-        (s<<6) + (s>>2));
+    // topo() is sorted, so predecessor lists come out sorted as well
+    std::vector<size_t> filled(pred_offsets.begin(), pred_offsets.end() - 1);
+    reduced->pred.resize(reduced->succ.size());
+    for (size_t i = 0; i < topo.size(); i++)
+      for (size_t j = succ_offsets[i]; j < succ_offsets[i+1]; j++)
+        reduced->pred[filled[event_index(reduced->succ[j])]++] = topo[i];
+
+    _reduced = reduced;
   }
 
   bool bernoulli_trial(const EdgeT& a, const EdgeT& b, double p) const {
@@ -199,8 +359,8 @@ class event_graph {
       reserve_max = 1;
 
     std::vector<EdgeT> res;
-    auto inc = inc_out_map.find(v);
-    if (inc != inc_out_map.end()) {
+    auto inc = _index->out.find(v);
+    if (inc != _index->out.end()) {
       auto other = std::lower_bound(inc->second.begin(), inc->second.end(), e,
           [](const EdgeT& e1, const EdgeT& e2) {
             return std::make_pair(e1.time, e1) < std::make_pair(e2.time, e2);
@@ -232,8 +392,8 @@ class event_graph {
     if (just_first)
       reserve_max = 1;
 
-    auto inc = inc_in_map.find(v);
-    if (inc != inc_in_map.end()) {
+    auto inc = _index->in.find(v);
+    if (inc != _index->in.end()) {
       auto other = std::lower_bound(inc->second.begin(), inc->second.end(), e,
           [](const EdgeT& e1, const EdgeT& e2) {
             return std::make_pair(e1.effect_time(), e1) < std::make_pair(e2.effect_time(), e2);
@@ -256,6 +416,63 @@ class event_graph {
     return res;
   }
 
+  // Drops the links e -> b implied by a path e -> b' -> c -> b, where b' is
+  // another successor of e and c takes effect on a vertex mutated by e. Each
+  // link of such a path spans fewer events of topo() than the dropped link, so
+  // by induction on that span dropping all of them at once keeps every event
+  // reachable from the same events.
+  std::vector<EdgeT>
+  reduced_successors(const EdgeT& e, std::vector<EdgeT> succ) const {
+    constexpr double cutoff = 1e-20;
+
+    if (succ.size() < 2)
+      return succ;
+
+    auto mutated = e.mutated_verts();
+    std::vector<EdgeT> returns;
+    for (auto&& b: succ)
+      for (auto&& w: b.mutated_verts())
+        for (auto&& c: successors_vert(b, w, false))
+          for (auto&& v: c.mutated_verts())
+            if (std::find(mutated.begin(), mutated.end(), v) != mutated.end()) {
+              returns.push_back(c);
+              break;
+            }
+
+    if (returns.empty())
+      return succ;
+
+    std::sort(returns.begin(), returns.end(),
+        [](const EdgeT& e1, const EdgeT& e2) {
+          return std::make_pair(e1.effect_time(), e1) <
+            std::make_pair(e2.effect_time(), e2);
+        });
+
+    auto implied = [this, &returns](const EdgeT& b) {
+      // latest returning events first, as in predecessors_vert()
+      auto c = std::partition_point(returns.begin(), returns.end(),
+          [&b](const EdgeT& r) { return r.effect_time() < b.time; });
+      double last_p = 1.0;
+      while (c > returns.begin() && last_p > cutoff) {
+        c--;
+        if (adjacent<>(*c, b)) {
+          last_p = prob(*c, b, _expected_dt);
+          if (bernoulli_trial(*c, b, last_p))
+            return true;
+        }
+      }
+      return false;
+    };
+
+    succ.erase(std::remove_if(succ.begin(), succ.end(), implied), succ.end());
+    return succ;
+  }
+
   static constexpr bool enable_deterministic_shortcut = std::is_same<
     EdgeT, dag::undirected_temporal_edge<VertexType, TimeType>>::value;
+
+  static constexpr bool enable_transitive_reduction = std::is_same<
+    EdgeT, dag::directed_temporal_edge<VertexType, TimeType>>::value ||
+    std::is_same<
+    EdgeT, dag::directed_delayed_temporal_edge<VertexType, TimeType>>::value;
 };
@@ -159,13 +159,14 @@ int main(int argc, const char* argv[]) {
     << "S_e-est" << " "
     << "S_n-real" << " "
     << "S_n-est" << "\n";
+  out_component_workspace<temp_edge> ws;
   for (auto&& p: out_comp_size) {
     temp_time start, end;
     std::tie(start, end) = p.second.lifetime();
 
     auto out_comp = out_component(eg, p.first,
         static_cast<size_t>(p.second.node_set().estimate()+0.5),
-        static_cast<size_t>(p.second.edge_set().estimate()+0.5));
+        static_cast<size_t>(p.second.edge_set().estimate()+0.5), ws);
 
     out_comps_file
       << out_comp.edge_set().size() << " "
@@ -0,0 +1,271 @@
+#ifndef IN_COMPONENT_SIZE_ESTIMATE_H
+#define IN_COMPONENT_SIZE_ESTIMATE_H
+
+#include <deque>
+#include <vector>
+#include <algorithm>
+#include <unordered_map>
+
+// In-components: the events, and vertices mutated by them, that could have
+// influenced an event. Mirror images of the out-component estimation and
+// search in out_component_size_estimate.hpp, which has to be included first.
+
+// Forward sweep over topo() estimating the in-component of each event. The
+// sketches of the predecessors of an event are merged into its own, and a
+// sketch is released once all successors of its event have been processed. If
+// `only_leaves' is set, only events with no successor are returned.
+template <class EdgeT,
+         template<typename> class EstimatorT = hll_estimator,
+         template<typename> class ReadOnlyEstimatorT = hll_estimator_readonly>
+std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+in_component_size_estimate(
+    const event_graph<EdgeT>& eg,
+    uint32_t seed,
+    bool only_leaves=false) {
+  return sweep_components<sweep_direction::in,
+         EdgeT, EstimatorT, ReadOnlyEstimatorT>(
+      eg, eg.topo(), seed, only_leaves,
+      [&eg](const EdgeT& e) { return eg.successors(e).size(); });
+}
+
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> generic_in_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+
+  ws.reset(eg);
+  std::vector<EdgeT>& search = ws.queue();
+  search.push_back(root);
+  size_t root_idx = eg.event_index(root);
+  ws.visit(root_idx);
+
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  counter<EdgeT, ExactEstimatorT> in_component(0, edge_size_est, node_size_est);
+  in_component.insert(root, root_idx, vertex_index);
+
+  for (size_t head = 0; head < search.size(); head++) {
+    EdgeT e = search[head];
+    for (auto&& p: eg.predecessors(e)) {
+      size_t p_idx = eg.event_index(p);
+      if (ws.visit(p_idx)) {
+        search.push_back(p);
+        in_component.insert(p, p_idx, vertex_index);
+      }
+    }
+  }
+
+  return in_component;
+}
+
+// In-component of `root' for deterministic adjacency, scanning topo()
+// backwards from the root. An event belongs to the in-component if it takes
+// effect on a vertex less than dt before an in-component event leaves that
+// vertex. Events with the same timestamp are decided together, since they
+// cannot influence each other.
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> deterministic_in_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+  using TimeType = typename EdgeT::TimeType;
+  using VertT = typename EdgeT::VertexType;
+
+  // a delayed event long before the root can still take effect in time, so
+  // the scan cannot stop early
+  constexpr bool delayed = std::is_same<EdgeT,
+            dag::directed_delayed_temporal_edge<VertT, TimeType>>::value;
+
+  ws.reset(eg);
+  std::vector<EdgeT>& same_time = ws.batch();
+
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  counter<EdgeT, ExactEstimatorT> in_component(0, edge_size_est, node_size_est);
+  in_component.insert(root, eg.event_index(root), vertex_index);
+
+  // ws.leaving(v) holds the times at which in-component events leave v,
+  // latest first
+  for (auto&& v: root.mutator_verts())
+    ws.leaving(eg.vertex_index(v)).push_back(root.time);
+  TimeType earliest = root.time;
+
+  auto influences = [&eg, &ws](const EdgeT& e) {
+    for (auto&& v: e.mutated_verts()) {
+      const auto& times = ws.leaving(eg.vertex_index(v));
+      // earliest in-component event leaving v after e takes effect
+      auto after = std::partition_point(times.begin(), times.end(),
+          [&e](TimeType t) { return t > e.effect_time(); });
+      if (after != times.begin() &&
+          *(after - 1) - e.effect_time() < eg.expected_dt())
+        return true;
+    }
+    return false;
+  };
+
+  const auto& topo = eg.topo();
+  auto topo_it = std::partition_point(topo.begin(), topo.end(),
+      [&root](const EdgeT& e) { return e.time < root.time; });
+
+  while (topo_it > topo.begin()) {
+    TimeType time = (topo_it - 1)->time;
+    if (!delayed && !(earliest - time < eg.expected_dt()))
+      break;
+
+    same_time.clear();
+    while (topo_it > topo.begin() && (topo_it - 1)->time == time) {
+      topo_it--;
+      if (influences(*topo_it))
+        same_time.push_back(*topo_it);
+    }
+
+    for (auto&& e: same_time) {
+      in_component.insert(e, eg.event_index(e), vertex_index);
+      for (auto&& v: e.mutator_verts())
+        ws.leaving(eg.vertex_index(v)).push_back(e.time);
+      earliest = e.time;
+    }
+  }
+
+  return in_component;
+}
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> in_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+
+  using TimeT = typename EdgeT::TimeType;
+  using VertT = typename EdgeT::VertexType;
+  using delayed = dag::directed_delayed_temporal_edge<VertT, TimeT>;
+  using directed = dag::directed_temporal_edge<VertT, TimeT>;
+  using undirected = dag::undirected_temporal_edge<VertT, TimeT>;
+
+  if (!eg.deterministic())
+    return generic_in_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
+  else if constexpr (std::is_same<EdgeT, directed>::value ||
+            std::is_same<EdgeT, undirected>::value ||
+            std::is_same<EdgeT, delayed>::value)
+    return deterministic_in_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
+  else
+    return generic_in_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
+}
+
+// In-components of a stream of time-ordered events under deterministic
+// adjacency (0 < b.time - a.effect_time() < dt). Instead of a sketch per
+// event, every vertex keeps the in-component sketches of the events that took
+// effect on it during the last dt, one per effect time, so memory is bounded by
+// the recently active vertices. A new event merges the sketches of its
+// mutator vertices, and its own sketch replaces everything that arrived
+// earlier at the vertices it both leaves and mutates, since it contains them.
+template <class EdgeT, template<typename> class EstimatorT>
+class streaming_in_components {
+  public:
+  using TimeType = typename EdgeT::TimeType;
+  using VertexType = typename EdgeT::VertexType;
+  using counter_type = counter<EdgeT, EstimatorT>;
+
+  streaming_in_components(TimeType dt, uint32_t seed)
+    : _dt(dt), _seed(seed) {}
+
+  // Adds `events', which all have to have the same timestamp, not earlier
+  // than that of any previous call. Calls `f(e, in_component)' for each.
+  template <class Function>
+  void add_same_time(const std::vector<EdgeT>& events, Function f) {
+    if (events.empty())
+      return;
+    TimeType time = events.front().time;
+
+    // events with the same timestamp cannot influence each other, so all of
+    // them are computed before any is added
+    std::vector<counter_type> comps;
+    comps.reserve(events.size());
+    for (auto&& e: events) {
+      comps.emplace_back(_seed);
+      for (auto&& v: e.mutator_verts()) {
+        auto arrivals = _arrivals.find(v);
+        if (arrivals == _arrivals.end())
+          continue;
+        expire(arrivals->second, time);
+        for (auto&& a: arrivals->second) {
+          if (!(a.effect_time < time))
+            break;
+          comps.back().merge(a.comp);
+        }
+      }
+      comps.back().insert(e);
+      f(e, comps.back());
+    }
+
+    for (size_t i = 0; i < events.size(); i++) {
+      const EdgeT& e = events[i];
+      auto mutators = e.mutator_verts();
+      for (auto&& v: e.mutated_verts()) {
+        auto& arrivals = _arrivals[v];
+        if (std::find(mutators.begin(), mutators.end(), v) != mutators.end())
+          while (!arrivals.empty() && arrivals.front().effect_time < time) {
+            arrivals.pop_front();
+            _live--;
+          }
+
+        auto pos = std::partition_point(arrivals.begin(), arrivals.end(),
+            [&e](const arrival& a) { return a.effect_time < e.effect_time(); });
+        if (pos != arrivals.end() && pos->effect_time == e.effect_time())
+          pos->comp.merge(comps[i]);
+        else {
+          arrivals.insert(pos, arrival{e.effect_time(), comps[i]});
+          _live++;
+        }
+      }
+    }
+  }
+
+  // drops every sketch that cannot influence events at or after `now'
+  void expire_all(TimeType now) {
+    for (auto it = _arrivals.begin(); it != _arrivals.end();) {
+      expire(it->second, now);
+      if (it->second.empty())
+        it = _arrivals.erase(it);
+      else
+        it++;
+    }
+  }
+
+  size_t live_vertices() const { return _arrivals.size(); }
+  size_t live_sketches() const { return _live; }
+
+  private:
+  struct arrival {
+    TimeType effect_time;
+    counter_type comp;
+  };
+
+  TimeType _dt;
+  uint32_t _seed;
+  // sorted by effect time
+  std::unordered_map<VertexType, std::deque<arrival>> _arrivals;
+  size_t _live = 0;
+
+  void expire(std::deque<arrival>& arrivals, TimeType now) {
+    while (!arrivals.empty() && arrivals.front().effect_time < now &&
+        !(now - arrivals.front().effect_time < _dt)) {
+      arrivals.pop_front();
+      _live--;
+    }
+  }
+};
+
+#endif /* IN_COMPONENT_SIZE_ESTIMATE_H */
@@ -2,6 +2,16 @@
 #include <fstream>
 #include <vector>
 #include <ctime>
+#include <mutex>
+#include <optional>
+#include <memory>
+#include <map>
+#include <array>
+#include <numeric>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
 
 #include <hyperloglog.hpp>
 #include <dag.hpp>
@@ -16,7 +26,16 @@
 #define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
 #endif
 
+#ifndef HLL_FINE_PERC
+#define HLL_FINE_PERC 16
+#endif
+
+#ifndef HLL_STORE_PERC
+#define HLL_STORE_PERC HLL_DENSE_PERC
+#endif
+
 using hll_t = hll::HyperLogLog<HLL_DENSE_PERC, 19>;
+using hll_fine_t = hll::HyperLogLog<HLL_FINE_PERC, 19>;
 
 using temp_net = NETWORK_TYPE;
 using temp_vert = typename temp_net::VertexType;
@@ -28,10 +47,33 @@ enum class prob_dist_types { deterministic, exponential };
 
 #include "measures.hpp"
 
-#include "opts.hpp"
+// sketches of the second, higher precision sweep of --two-tier
+template <typename T>
+using hll_fine_estimator = basic_hll_estimator<T, hll_fine_t>;
+template <typename T>
+using hll_fine_estimator_readonly = basic_hll_estimator_readonly<T, hll_fine_t>;
+
+#include "parallel.hpp"
 #include "event_graph.hpp"
 #include "network.hpp"
+#include "opts.hpp"
 #include "out_component_size_estimate.hpp"
+#include "sketch_store.hpp"
+
+// sketches of the --sketch-store sweep: the search runs on the usual sketches
+// and the store registers are carried alongside
+template <typename T>
+using hll_store_estimator =
+  stored_estimator<T, hll_estimator, HLL_STORE_PERC>;
+template <typename T>
+using hll_store_estimator_readonly = stored_estimator_readonly<T,
+      hll_estimator, hll_estimator_readonly, HLL_STORE_PERC>;
+template <typename T>
+using hll_ensemble_store_estimator =
+  stored_estimator<T, hll_ensemble_estimator, HLL_STORE_PERC>;
+template <typename T>
+using hll_ensemble_store_estimator_readonly = stored_estimator_readonly<T,
+      hll_ensemble_estimator, hll_ensemble_estimator_readonly, HLL_STORE_PERC>;
 
 auto parse_options(int, const char*);
 
@@ -42,7 +84,7 @@ class null_buffer : public std::streambuf {
 };
 
 size_t measure_size(
-    const counter<temp_edge, exact_estimator>& c,
+    const counter<temp_edge, EXACT_ESTIMATOR>& c,
     size_measures measure) {
   if (measure == size_measures::events)
     return c.edge_set().size();
@@ -59,8 +101,9 @@ size_t measure_size(
     return eg.node_count();
 }
 
+template <template<typename> class ReadOnlyEstimatorT>
 double measure_estimate(
-    const counter<temp_edge, hll_estimator_readonly>& c,
+    const counter<temp_edge, ReadOnlyEstimatorT>& c,
     size_measures measure) {
   if (measure == size_measures::events)
     return c.edge_set().estimate();
@@ -68,82 +111,878 @@ double measure_estimate(
     return c.node_set().estimate();
 }
 
+// Number of candidates, taken in order of the given estimates, after which
+// the accumulated log-probability of none of them being larger than `limit'
+// falls below `cutoff'.
+template <template<typename> class ReadOnlyEstimatorT>
+size_t candidates_until_cutoff(
+    const std::vector<double>& estimates,
+    size_t limit, size_t max_size, double cutoff) {
+  std::vector<double> p_larger = ReadOnlyEstimatorT<temp_edge>::p_larger(
+      estimates, limit, max_size);
+
+  size_t taken = 0;
+  double p_smaller_total = 1.0;
+  while (taken < p_larger.size() && p_smaller_total > cutoff)
+    p_smaller_total += std::log(1.0 - p_larger[taken++]);
+  return taken;
+}
+
+// Given p_larger of candidates in decreasing order, number of leading
+// candidates that have to be verified so that the probability of any of the
+// others being larger stays within `significance'.
+size_t candidates_needed(const std::vector<double>& p_larger,
+    double significance) {
+  double cutoff = std::log(1-significance);
+  double p_smaller_total = 0.0;
+  size_t needed = p_larger.size();
+  while (needed > 0 &&
+      p_smaller_total + std::log(1.0 - p_larger[needed-1]) > cutoff)
+    p_smaller_total += std::log(1.0 - p_larger[--needed]);
+  return needed;
+}
+
 using probabilistic_counter = counter<temp_edge, hll_estimator_readonly>;
-using exact_counter = counter<temp_edge, exact_estimator>;
+using exact_counter = counter<temp_edge, EXACT_ESTIMATOR>;
+
+// Exact out-component of `root' with estimate `est'. Out-components estimated
+// to have more than `parallel_threshold' events (0 disables) are searched with
+// a parallel breadth-first search on `threads' threads.
+template <template<typename> class ReadOnlyEstimatorT>
+exact_counter exact_out_component(
+    const event_graph<temp_edge>& eg,
+    const temp_edge& root,
+    const counter<temp_edge, ReadOnlyEstimatorT>& est,
+    size_t parallel_threshold,
+    size_t threads) {
+  size_t node_size_est = (size_t)(est.node_set().estimate()*1.05);
+  size_t edge_size_est = (size_t)(est.edge_set().estimate()*1.05);
+  if (parallel_threshold > 0 && worker_count(threads) > 1 &&
+      est.edge_set().estimate() > (double)parallel_threshold)
+    return parallel_out_component<EXACT_ESTIMATOR>(eg, root,
+        node_size_est, edge_size_est, threads);
+  return out_component<EXACT_ESTIMATOR>(eg, root,
+      node_size_est, edge_size_est);
+}
+
+// Exact out-components of the roots with the largest out-component w.r.t.
+// number of events, number of nodes and lifetime.
+struct largest_components {
+  std::shared_ptr<exact_counter> events, nodes, lifetime;
+};
+
+// For events and nodes, the root with the largest estimate is searched first
+// and the other roots are verified in decreasing order of estimate until the
+// probability of any unverified one being larger falls within
+// `significance'. For lifetime, the root with the longest estimated lifetime
+// (which is exact) is taken. The candidate sets of all measures are verified
+// together, so that each exact out-component is computed at most once.
+template <template<typename> class ReadOnlyEstimatorT>
+largest_components largest_out_components(
+    const event_graph<temp_edge>& eg,
+    const std::vector<std::pair<temp_edge,
+      counter<temp_edge, ReadOnlyEstimatorT>>>& out_comps,
+    double significance,
+    size_t threads,
+    size_t parallel_bfs_threshold=0) {
+
+  constexpr size_t measure_count = 2;
+  const std::array<size_measures, measure_count> measures =
+    {size_measures::events, size_measures::nodes};
+
+  // exact out-components computed so far, keyed by position in out_comps
+  std::unordered_map<size_t, std::shared_ptr<exact_counter>> cache;
+  auto cached_out_component = [&](size_t idx) {
+    auto it = cache.find(idx);
+    if (it != cache.end())
+      return it->second;
+    auto comp = std::make_shared<exact_counter>(exact_out_component(eg,
+          out_comps[idx].first, out_comps[idx].second,
+          parallel_bfs_threshold, threads));
+    cache.emplace(idx, comp);
+    return comp;
+  };
+
+  largest_components result;
+
+  size_t max_lt_idx = 0;
+  for (size_t i = 0; i < out_comps.size(); i++) {
+    temp_time t1, t2;
+    std::tie(t1, t2) = out_comps[i].second.lifetime();
+
+    temp_time max_t1, max_t2;
+    std::tie(max_t1, max_t2) = out_comps[max_lt_idx].second.lifetime();
+
+    if ((max_t2 - max_t1) < (t2 - t1))
+      max_lt_idx = i;
+  }
+  result.lifetime = cached_out_component(max_lt_idx);
+
+  // candidates of each measure in the order of the sequential search
+  std::array<std::vector<size_t>, measure_count> candidates;
+  std::array<std::shared_ptr<exact_counter>, measure_count> best;
+  std::array<size_t, measure_count> best_size;
+
+  double cutoff = std::log(1-significance);
+
+  for (size_t m = 0; m < measure_count; m++) {
+    size_measures measure = measures[m];
+
+    std::vector<size_t> order(out_comps.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(),
+        [&out_comps, measure](size_t a, size_t b) {
+          double est_a = measure_estimate(out_comps[a].second, measure);
+          double est_b = measure_estimate(out_comps[b].second, measure);
+          return std::make_pair(est_a, a) < std::make_pair(est_b, b);
+        });
+
+    size_t top = order.back();
+    order.pop_back();
+    best[m] = cached_out_component(top);
+    best_size[m] = measure_size(*best[m], measure);
+    size_t loc_max = measure_size(eg, measure);
+
+    std::cerr << "loc-candidate-size: " << best_size[m] <<
+      " (est: " << measure_estimate(out_comps[top].second, measure) << ")"
+      << std::endl;
+
+    std::vector<double> estimates;
+    estimates.reserve(order.size());
+    for (size_t idx: order)
+      estimates.push_back(measure_estimate(out_comps[idx].second, measure));
+
+    auto current_candidate = order.begin() +
+      (std::ptrdiff_t)candidates_until_cutoff<ReadOnlyEstimatorT>(
+          estimates, best_size[m], loc_max, cutoff);
+    if (current_candidate != order.begin())
+      current_candidate--;
+
+    candidates[m].assign(current_candidate, order.end());
+  }
+
+  // union of the candidate sets. rank of a candidate for each measure is its
+  // one-based position in that measure's search order, or zero if it is not a
+  // candidate for that measure.
+  std::map<size_t, std::array<size_t, measure_count>> ranks;
+  for (size_t m = 0; m < measure_count; m++)
+    for (size_t r = 0; r < candidates[m].size(); r++)
+      ranks[candidates[m][r]][m] = r + 1;
+  std::vector<std::pair<size_t, std::array<size_t, measure_count>>>
+    jobs(ranks.begin(), ranks.end());
+
+  std::cerr << "manual-bfs: " << jobs.size() << std::endl;
+
+  std::atomic<size_t> best_events(best_size[0]), best_nodes(best_size[1]);
+  const std::atomic<size_t> unlimited(std::numeric_limits<size_t>::max());
+  std::array<std::atomic<size_t>*, measure_count> shared_best =
+    {&best_events, &best_nodes};
+  std::atomic<size_t> remaining(jobs.size());
+  std::mutex log_mutex;
+
+  // best candidate of each measure seen by each worker. Ties are broken in
+  // favour of the lower rank, the initial candidate having rank zero.
+  struct local_best {
+    size_t size, rank;
+    std::shared_ptr<exact_counter> comp;
+  };
+  size_t workers = worker_count(threads);
+  std::vector<std::array<local_best, measure_count>> worker_best(workers);
+  for (auto&& wb: worker_best)
+    for (size_t m = 0; m < measure_count; m++)
+      wb[m] = {best_size[m], 0, nullptr};
+
+  parallel_for(jobs.size(), workers,
+      [&](size_t i, size_t thread_idx) {
+        size_t idx = jobs[i].first;
+        const auto& rank = jobs[i].second;
+
+        // the cache is only written before and after the parallel section
+        std::shared_ptr<exact_counter> comp;
+        auto cached = cache.find(idx);
+        if (cached != cache.end()) {
+          comp = cached->second;
+        } else {
+          const auto& est = out_comps[idx].second;
+          auto out_comp = bounded_out_component<EXACT_ESTIMATOR>(
+              eg, out_comps[idx].first,
+              (size_t)(est.node_set().estimate()*1.05),
+              (size_t)(est.edge_set().estimate()*1.05),
+              rank[0] > 0 ? best_events : unlimited,
+              rank[1] > 0 ? best_nodes : unlimited);
+          if (out_comp)
+            comp = std::make_shared<exact_counter>(std::move(*out_comp));
+        }
+
+        if (comp)
+          for (size_t m = 0; m < measure_count; m++) {
+            if (rank[m] == 0)
+              continue;
+            size_t comp_size = measure_size(*comp, measures[m]);
+            auto& local = worker_best[thread_idx][m];
+            if (comp_size > local.size ||
+                (comp_size == local.size && local.comp && rank[m] < local.rank)) {
+              local = {comp_size, rank[m], comp};
+              atomic_max(*shared_best[m], comp_size);
+            }
+          }
+
+        size_t left = --remaining;
+        if (left % 10 == 0) {
+          std::lock_guard<std::mutex> lock(log_mutex);
+          std::cerr << "manual bfs remaining: " << left << std::endl;
+        }
+      });
 
-// We didn't use const std::vector<...> out_comps because we explicitly want a
-// copy to manipulate (sort and pop and on)
-exact_counter largest_out_component(
+  for (size_t m = 0; m < measure_count; m++) {
+    size_t best_rank = 0;
+    for (auto&& wb: worker_best) {
+      const auto& local = wb[m];
+      if (!local.comp)
+        continue;
+      if (local.size > best_size[m] ||
+          (local.size == best_size[m] && local.rank < best_rank)) {
+        best_size[m] = local.size;
+        best_rank = local.rank;
+        best[m] = local.comp;
+      }
+    }
+  }
+
+  result.events = best[0];
+  result.nodes = best[1];
+  return result;
+}
+
+
+struct ranked_component {
+  size_t size, rank;
+  std::shared_ptr<exact_counter> comp;
+};
+
+struct top_components {
+  std::vector<ranked_component> components;
+  size_t verified;
+};
+
+// The k largest out-components by `measure', largest first. Roots with the k
+// largest estimates are verified first, giving a lower bound for the k-th
+// largest size. Other roots are then verified, largest estimate first, until
+// the probability that any of the remaining ones is larger than that bound is
+// below `significance'. Ties are broken in favour of the larger estimate.
+template <template<typename> class ReadOnlyEstimatorT>
+top_components top_k_out_components(
     const event_graph<temp_edge>& eg,
-    std::vector<std::pair<temp_edge, probabilistic_counter>> out_comps,
+    const std::vector<std::pair<temp_edge,
+      counter<temp_edge, ReadOnlyEstimatorT>>>& out_comps,
+    size_t k,
     size_measures measure,
-    double significance) {
+    double significance,
+    size_t threads) {
+  k = std::min(k, out_comps.size());
+
+  std::vector<double> estimates(out_comps.size());
+  for (size_t i = 0; i < out_comps.size(); i++)
+    estimates[i] = measure_estimate(out_comps[i].second, measure);
+
+  auto larger_estimate = [&estimates](size_t a, size_t b) {
+    return estimates[a] > estimates[b] ||
+      (estimates[a] == estimates[b] && a < b);
+  };
+
+  std::vector<size_t> order(out_comps.size());
+  std::iota(order.begin(), order.end(), 0);
+  auto kth = order.begin() + (std::ptrdiff_t)k;
+  if (k < order.size())
+    std::nth_element(order.begin(), kth, order.end(), larger_estimate);
+  std::sort(order.begin(), kth, larger_estimate);
 
-  std::sort(out_comps.begin(), out_comps.end(),
-      [measure] (
-        const std::pair<temp_edge, probabilistic_counter>& a,
-        const std::pair<temp_edge, probabilistic_counter>& b) {
-      return measure_estimate(a.second, measure) <
-      measure_estimate(b.second, measure);
+  // current top-k as a heap with the smallest (and last ranked) on top
+  auto better = [](const ranked_component& a, const ranked_component& b) {
+    return a.size > b.size || (a.size == b.size && a.rank < b.rank);
+  };
+  std::vector<ranked_component> top;
+  std::mutex top_mutex;
+  std::atomic<size_t> kth_size(0);
+  std::atomic<size_t> unlimited(std::numeric_limits<size_t>::max());
+
+  // searches that provably cannot reach the current k-th size are abandoned
+  auto verify = [&](size_t idx, size_t rank) {
+    const auto& est = out_comps[idx].second;
+    auto out_comp = bounded_out_component<EXACT_ESTIMATOR>(
+        eg, out_comps[idx].first,
+        (size_t)(est.node_set().estimate()*1.05),
+        (size_t)(est.edge_set().estimate()*1.05),
+        measure == size_measures::events ? kth_size : unlimited,
+        measure == size_measures::nodes ? kth_size : unlimited);
+    if (!out_comp)
+      return;
+
+    ranked_component rc{measure_size(*out_comp, measure), rank, nullptr};
+    std::lock_guard<std::mutex> lock(top_mutex);
+    if (top.size() == k && !better(rc, top.front()))
+      return;
+    rc.comp = std::make_shared<exact_counter>(std::move(*out_comp));
+    top.push_back(rc);
+    std::push_heap(top.begin(), top.end(), better);
+    if (top.size() > k) {
+      std::pop_heap(top.begin(), top.end(), better);
+      top.pop_back();
+    }
+    if (top.size() == k)
+      kth_size.store(top.front().size);
+  };
+
+  parallel_for(k, threads, [&](size_t i, size_t /*thread_idx*/) {
+        verify(order[i], i + 1);
       });
 
-  auto loc_event = out_comps.back().first;
-  auto loc_est = out_comps.back().second;
-  auto loc = out_component(eg, loc_event,
-      (size_t)(loc_est.node_set().estimate()*1.05),
-      (size_t)(loc_est.edge_set().estimate()*1.05));
-  size_t loc_size = measure_size(loc, measure);
-  size_t loc_max = measure_size(eg, measure);
+  // Only roots with a non-zero chance of beating the k-th size are ranked.
+  // Those least likely to are skipped as long as the probability of any of
+  // them being larger stays within significance. The k-th size only grows
+  // during verification, so this remains conservative.
+  std::vector<double> rest_estimates;
+  rest_estimates.reserve(order.size() - k);
+  for (auto it = kth; it != order.end(); it++)
+    rest_estimates.push_back(estimates[*it]);
+  std::vector<double> p_larger = ReadOnlyEstimatorT<temp_edge>::p_larger(
+      rest_estimates, kth_size.load(), measure_size(eg, measure));
 
-  std::cerr << "loc-candidate-size: " << loc_size <<
-    " (est: " << measure_estimate(loc_est, measure) << ")"<< std::endl;
+  std::vector<std::pair<double, size_t>> rest;
+  for (size_t i = 0; i < p_larger.size(); i++)
+    if (p_larger[i] > 0.0)
+      rest.emplace_back(p_larger[i], *(kth + (std::ptrdiff_t)i));
+  std::sort(rest.begin(), rest.end(),
+      [&larger_estimate](const std::pair<double, size_t>& a,
+        const std::pair<double, size_t>& b) {
+        return larger_estimate(a.second, b.second);
+      });
 
-  out_comps.pop_back();
+  std::vector<double> rest_p(rest.size());
+  for (size_t i = 0; i < rest.size(); i++)
+    rest_p[i] = rest[i].first;
+  size_t needed = candidates_needed(rest_p, significance);
 
-  auto current_candidate = out_comps.begin();
+  std::cerr << "top-k-bfs: " << needed << std::endl;
 
-  double cutoff = std::log(1-significance);
-  double p_smaller_total = 1.0;
+  parallel_for(needed, threads, [&](size_t i, size_t /*thread_idx*/) {
+        verify(rest[i].second, k + i + 1);
+      });
+
+  std::sort(top.begin(), top.end(), better);
+  return {top, k + needed};
+}
 
-  while (current_candidate != out_comps.end() &&
-      p_smaller_total > cutoff) {
-    double p_larger = hll_estimator_readonly<temp_edge>::p_larger(
-            measure_estimate(current_candidate->second, measure),
-            loc_size, loc_max);
-    p_smaller_total += std::log(1.0 - p_larger);
-    current_candidate++;
+
+// Positions in out_comps of roots that cannot be told apart from the largest
+// by `measure' at the precision of the estimates, most likely first. The true
+// size of the root with the largest estimate is taken to be at least
+// estimate/(1 + 3 sigma), and roots are kept until the probability of any of
+// the others being larger than that is within `significance'.
+template <template<typename> class ReadOnlyEstimatorT>
+std::vector<size_t> ambiguous_roots(
+    const event_graph<temp_edge>& eg,
+    const std::vector<std::pair<temp_edge,
+      counter<temp_edge, ReadOnlyEstimatorT>>>& out_comps,
+    size_measures measure,
+    double significance) {
+  if (out_comps.empty())
+    return {};
+
+  std::vector<double> estimates(out_comps.size());
+  for (size_t i = 0; i < out_comps.size(); i++)
+    estimates[i] = measure_estimate(out_comps[i].second, measure);
+  size_t top = (size_t)(std::max_element(estimates.begin(), estimates.end())
+      - estimates.begin());
+
+  double sigma = ReadOnlyEstimatorT<temp_edge>::relative_error();
+  std::vector<double> p_larger = ReadOnlyEstimatorT<temp_edge>::p_larger(
+      estimates, (size_t)(estimates[top]/(1.0 + 3.0*sigma)),
+      measure_size(eg, measure));
+
+  std::vector<size_t> rest;
+  for (size_t i = 0; i < out_comps.size(); i++)
+    if (i != top && p_larger[i] > 0.0)
+      rest.push_back(i);
+  std::sort(rest.begin(), rest.end(), [&estimates](size_t a, size_t b) {
+        return estimates[a] > estimates[b] ||
+          (estimates[a] == estimates[b] && a < b);
+      });
+
+  std::vector<double> rest_p(rest.size());
+  for (size_t i = 0; i < rest.size(); i++)
+    rest_p[i] = p_larger[rest[i]];
+  rest.resize(candidates_needed(rest_p, significance));
+
+  rest.insert(rest.begin(), top);
+  return rest;
+}
+
+// out-component estimates of all events, or only of the roots, from the
+// sweep selected by --vertex-states or --contract-chains. `threads' is used
+// to find the chains.
+template <template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+std::vector<std::pair<temp_edge, counter<temp_edge, ReadOnlyEstimatorT>>>
+estimate_out_components(
+    const event_graph<temp_edge>& eg,
+    const options_t& opts,
+    bool only_roots,
+    size_t threads,
+    const root_callback<temp_edge, ReadOnlyEstimatorT>& on_root={},
+    const sketch_callback<temp_edge, EstimatorT>& on_sketch={}) {
+  if (opts.vertex_states)
+    return vertex_state_out_component_size_estimate<temp_edge,
+           EstimatorT, ReadOnlyEstimatorT>(
+               eg, opts.hll_seed, only_roots, on_root, on_sketch);
+  else if (opts.contract_chains)
+    return contracted_out_component_size_estimate<temp_edge,
+           EstimatorT, ReadOnlyEstimatorT>(
+               eg, find_event_chains(eg, threads),
+               opts.hll_seed, only_roots, on_root, on_sketch);
+  else
+    return out_component_size_estimate<temp_edge,
+           EstimatorT, ReadOnlyEstimatorT>(
+               eg, opts.hll_seed, only_roots, on_root, on_sketch);
+}
+
+// Largest out-components from a cheap sweep at the compiled precision: roots
+// that are ambiguous by events or nodes, and the root with the longest
+// lifetime, are re-estimated at HLL_FINE_PERC with a second sweep over only
+// the events reachable from them. Only the candidates that survive that are
+// verified exactly.
+template <template<typename> class ReadOnlyEstimatorT>
+largest_components two_tier_largest_out_components(
+    const event_graph<temp_edge>& eg,
+    const std::vector<std::pair<temp_edge,
+      counter<temp_edge, ReadOnlyEstimatorT>>>& out_comps,
+    const options_t& opts,
+    std::ofstream& summary_file) {
+  std::vector<size_t> selected;
+  for (auto measure: {size_measures::events, size_measures::nodes}) {
+    auto ambiguous = ambiguous_roots(eg, out_comps, measure,
+        opts.significance);
+    selected.insert(selected.end(), ambiguous.begin(), ambiguous.end());
+  }
+
+  size_t max_lt_idx = 0;
+  for (size_t i = 0; i < out_comps.size(); i++) {
+    auto lt = out_comps[i].second.lifetime();
+    auto max_lt = out_comps[max_lt_idx].second.lifetime();
+    if (lt.second - lt.first > max_lt.second - max_lt.first)
+      max_lt_idx = i;
   }
+  selected.push_back(max_lt_idx);
+
+  std::sort(selected.begin(), selected.end());
+  selected.erase(std::unique(selected.begin(), selected.end()),
+      selected.end());
 
-  current_candidate--;
+  std::vector<temp_edge> roots;
+  for (size_t idx: selected)
+    roots.push_back(out_comps[idx].first);
+  std::vector<temp_edge> sub_dag = reachable_events(eg, roots);
 
-  std::cerr << "manual-bfs: " << out_comps.end() - current_candidate
+  summary_file << "two-tier-roots: " << roots.size() << std::endl;
+  summary_file << "two-tier-events: " << sub_dag.size() << std::endl;
+
+  auto fine_start = std::clock();
+  auto fine_out_comps = out_component_size_estimate<temp_edge,
+       hll_fine_estimator, hll_fine_estimator_readonly>(
+           eg, sub_dag, opts.hll_seed, true);
+  auto fine_end = std::clock();
+  summary_file << "fine-estimate-time: "
+    << (double)(1000 * (fine_end-fine_start))/CLOCKS_PER_SEC
     << std::endl;
 
-  while (current_candidate != out_comps.end()) {
-    // we are giving an upper bound on out-component size to prevent rehash in
-    // worst-case, but number of vertices are usually exact.
-    auto current_est = current_candidate->second;
-    auto out_comp = out_component(eg, current_candidate->first,
-        (size_t)(current_est.node_set().estimate()*1.05),
-        (size_t)(current_est.edge_set().estimate()*1.05));
-    auto comp_size = measure_size(out_comp, measure);
-    if (comp_size > loc_size) {
-      loc = out_comp;
-      loc_size = comp_size;
-      loc_event = current_candidate->first;
+  return largest_out_components(eg, fine_out_comps,
+      opts.significance, opts.threads, opts.parallel_bfs_threshold);
+}
+
+
+// Runs the estimation sweep and verifies roots while it is still going. Each
+// root is handed to the verifier threads as soon as its estimate is final,
+// and they take the largest pending estimate by events first, skipping roots
+// that have no chance of beating the best exact sizes found so far. Once the
+// sweep is over, the significance cutoff of largest_out_components() is
+// applied to the roots that were not verified yet. The roots and their
+// estimates are returned in `out_comps'.
+template <template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+largest_components pipelined_largest_out_components(
+    const event_graph<temp_edge>& eg,
+    const options_t& opts,
+    std::vector<std::pair<temp_edge,
+      counter<temp_edge, ReadOnlyEstimatorT>>>& out_comps,
+    std::ofstream& summary_file,
+    const sketch_callback<temp_edge, EstimatorT>& on_sketch={}) {
+  using prob_counter = counter<temp_edge, ReadOnlyEstimatorT>;
+
+  constexpr size_t measure_count = 2;
+  const std::array<size_measures, measure_count> measures =
+    {size_measures::events, size_measures::nodes};
+
+  std::array<std::atomic<size_t>, measure_count> best_size;
+  std::array<std::shared_ptr<exact_counter>, measure_count> best;
+  std::array<temp_edge, measure_count> best_root;
+  for (auto&& b: best_size)
+    b.store(0);
+  std::mutex best_mutex;
+
+  // exact search, abandoned if it cannot reach the best of either measure.
+  // Ties go to the smaller root event, so that the result does not depend on
+  // the order in which the verifiers finish.
+  auto verify = [&](const temp_edge& root, const prob_counter& est) {
+    auto out_comp = bounded_out_component<EXACT_ESTIMATOR>(eg, root,
+        (size_t)(est.node_set().estimate()*1.05),
+        (size_t)(est.edge_set().estimate()*1.05),
+        best_size[0], best_size[1]);
+    if (!out_comp)
+      return;
+
+    auto comp = std::make_shared<exact_counter>(std::move(*out_comp));
+    std::lock_guard<std::mutex> lock(best_mutex);
+    for (size_t m = 0; m < measure_count; m++) {
+      size_t comp_size = measure_size(*comp, measures[m]);
+      size_t best_comp_size = best[m] ? measure_size(*best[m], measures[m]) : 0;
+      if (!best[m] || comp_size > best_comp_size ||
+          (comp_size == best_comp_size && root < best_root[m])) {
+        best[m] = comp;
+        best_root[m] = root;
+        atomic_max(best_size[m], comp_size);
+      }
     }
-    if ((out_comps.end() - current_candidate) % 10 == 0)
-      std::cerr << "manual bfs remaining: " << (out_comps.end() - current_candidate) <<
-        " last size: "<< comp_size
-        << " (est: " << measure_estimate(current_est, measure) << ")"
-        << std::endl;
-    current_candidate++;
+  };
+
+  auto hopeful = [&](const prob_counter& est) {
+    for (size_t m = 0; m < measure_count; m++) {
+      size_t limit = best_size[m].load();
+      if (limit == 0 || ReadOnlyEstimatorT<temp_edge>::p_larger(
+            measure_estimate(est, measures[m]),
+            limit, measure_size(eg, measures[m])) > 0.0)
+        return true;
+    }
+    return false;
+  };
+
+  // roots in the order they were finished, and a heap of the ones not yet
+  // picked up by a verifier
+  std::deque<std::pair<temp_edge, prob_counter>> finished;
+  std::deque<bool> verified;
+  std::vector<size_t> pending;
+  bool sweep_done = false;
+  std::mutex pending_mutex;
+  std::condition_variable pending_cv;
+
+  auto smaller_estimate = [&finished](size_t a, size_t b) {
+    return finished[a].second.edge_set().estimate() <
+      finished[b].second.edge_set().estimate();
+  };
+
+  auto verifier = [&]() {
+    std::unique_lock<std::mutex> lock(pending_mutex);
+    while (true) {
+      pending_cv.wait(lock, [&] { return !pending.empty() || sweep_done; });
+      if (sweep_done)
+        return;
+
+      std::pop_heap(pending.begin(), pending.end(), smaller_estimate);
+      size_t idx = pending.back();
+      pending.pop_back();
+      auto root = finished[idx];
+
+      lock.unlock();
+      bool verify_root = hopeful(root.second);
+      if (verify_root)
+        verify(root.first, root.second);
+      lock.lock();
+      verified[idx] = verify_root;
+    }
+  };
+
+  auto on_root = [&](const temp_edge& root, const prob_counter& est) {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    finished.emplace_back(root, est);
+    verified.push_back(false);
+    pending.push_back(finished.size() - 1);
+    std::push_heap(pending.begin(), pending.end(), smaller_estimate);
+    pending_cv.notify_one();
+  };
+
+  size_t verifier_count = std::max<size_t>(worker_count(opts.threads), 2) - 1;
+  std::vector<std::thread> verifiers;
+  for (size_t t = 0; t < verifier_count; t++)
+    verifiers.emplace_back(verifier);
+
+  out_comps = estimate_out_components<EstimatorT, ReadOnlyEstimatorT>(
+      eg, opts, true, opts.threads, on_root, on_sketch);
+
+  {
+    std::lock_guard<std::mutex> lock(pending_mutex);
+    sweep_done = true;
   }
+  pending_cv.notify_all();
+  for (auto&& t: verifiers)
+    t.join();
 
-  return loc;
+  size_t during_sweep = (size_t)std::count(
+      verified.begin(), verified.end(), true);
+  summary_file << "pipeline-verified-during-sweep: " << during_sweep
+    << std::endl;
+
+  // cutoff over the rest, against the best sizes at the end of the sweep
+  std::vector<size_t> rest;
+  for (size_t i = 0; i < out_comps.size(); i++)
+    if (!verified[i])
+      rest.push_back(i);
+
+  std::vector<bool> needed(out_comps.size(), false);
+  for (size_t m = 0; m < measure_count; m++) {
+    std::vector<double> estimates;
+    for (size_t idx: rest)
+      estimates.push_back(measure_estimate(out_comps[idx].second, measures[m]));
+    std::vector<size_t> order(rest.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&estimates](size_t a, size_t b) {
+          return estimates[a] > estimates[b];
+        });
+
+    std::vector<double> sorted_estimates;
+    for (size_t i: order)
+      sorted_estimates.push_back(estimates[i]);
+
+    std::vector<double> p_larger;
+    if (best_size[m].load() == 0)
+      p_larger.assign(sorted_estimates.size(), 1.0);
+    else
+      p_larger = ReadOnlyEstimatorT<temp_edge>::p_larger(sorted_estimates,
+          best_size[m].load(), measure_size(eg, measures[m]));
+
+    size_t count = candidates_needed(p_larger, opts.significance);
+    for (size_t i = 0; i < count; i++)
+      needed[rest[order[i]]] = true;
+  }
+
+  std::vector<size_t> after_sweep;
+  for (size_t idx: rest)
+    if (needed[idx])
+      after_sweep.push_back(idx);
+  std::sort(after_sweep.begin(), after_sweep.end(),
+      [&out_comps](size_t a, size_t b) {
+        return out_comps[a].second.edge_set().estimate() >
+          out_comps[b].second.edge_set().estimate();
+      });
+  summary_file << "pipeline-verified-after-sweep: " << after_sweep.size()
+    << std::endl;
+
+  parallel_for(after_sweep.size(), opts.threads,
+      [&](size_t i, size_t /*thread_idx*/) {
+        verify(out_comps[after_sweep[i]].first,
+            out_comps[after_sweep[i]].second);
+      });
+
+  size_t max_lt_idx = 0;
+  for (size_t i = 0; i < out_comps.size(); i++) {
+    temp_time t1, t2;
+    std::tie(t1, t2) = out_comps[i].second.lifetime();
+
+    temp_time max_t1, max_t2;
+    std::tie(max_t1, max_t2) = out_comps[max_lt_idx].second.lifetime();
+
+    if ((max_t2 - max_t1) < (t2 - t1))
+      max_lt_idx = i;
+  }
+
+  largest_components result;
+  result.events = best[0];
+  result.nodes = best[1];
+  result.lifetime = std::make_shared<exact_counter>(exact_out_component(eg,
+        out_comps[max_lt_idx].first, out_comps[max_lt_idx].second,
+        opts.parallel_bfs_threshold, opts.threads));
+  return result;
 }
 
 
+template <template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+void find_largest_components(
+    const event_graph<temp_edge>& eg,
+    const options_t& opts,
+    std::ofstream& summary_file,
+    const sketch_callback<temp_edge, EstimatorT>& on_sketch={}) {
+  std::vector<std::pair<temp_edge, counter<temp_edge, ReadOnlyEstimatorT>>>
+    out_comp_size;
+  largest_components locs;
+
+  if (opts.pipeline) {
+    auto pipeline_start = std::chrono::steady_clock::now();
+    locs = pipelined_largest_out_components<EstimatorT, ReadOnlyEstimatorT>(
+        eg, opts, out_comp_size, summary_file, on_sketch);
+    auto pipeline_end = std::chrono::steady_clock::now();
+    summary_file << "root-events: " << out_comp_size.size() << std::endl;
+    summary_file << "pipeline-wall-time: "
+      << std::chrono::duration<double, std::milli>(
+          pipeline_end-pipeline_start).count()
+      << std::endl;
+  } else {
+    auto estimate_start = std::clock();
+    out_comp_size = estimate_out_components<EstimatorT, ReadOnlyEstimatorT>(
+        eg,
+        opts,
+        true, // return the estimation only for events with no predecessor
+        opts.threads,
+        {},
+        on_sketch);
+    auto estimate_end = std::clock();
+    summary_file << "estimate-time: "
+      << (double)(1000 * (estimate_end-estimate_start))/CLOCKS_PER_SEC
+      << std::endl;
+
+    summary_file << "root-events: " << out_comp_size.size() << std::endl;
+
+    auto largest_start = std::clock();
+    if (opts.two_tier)
+      locs = two_tier_largest_out_components(eg, out_comp_size,
+          opts, summary_file);
+    else
+      locs = largest_out_components(eg, out_comp_size,
+          opts.significance, opts.threads, opts.parallel_bfs_threshold);
+    auto largest_end = std::clock();
+    summary_file << "largest-search-time: "
+      << (double)(1000 * (largest_end-largest_start))/CLOCKS_PER_SEC
+      << std::endl;
+  }
+
+  summary_file << "loc-e: " << locs.events->edge_set().size() << std::endl;
+  summary_file << "loc-g: " << locs.nodes->node_set().size() << std::endl;
+
+  const auto& loc_lt = *locs.lifetime;
+  temp_time max_t1, max_t2;
+  std::tie(max_t1, max_t2) = loc_lt.lifetime();
+  summary_file << "loc-lt: " << max_t2 - max_t1 << std::endl;
+  summary_file << "loc-lt-begin: " << max_t1 << std::endl;
+  summary_file << "loc-lt-end: "   << max_t2 << std::endl;
+
+  if (opts.top_k > 0) {
+    auto top_start = std::clock();
+    auto top = top_k_out_components(eg, out_comp_size,
+        opts.top_k, opts.size_measure, opts.significance, opts.threads);
+    auto top_end = std::clock();
+    summary_file << "top-k-search-time: "
+      << (double)(1000 * (top_end-top_start))/CLOCKS_PER_SEC
+      << std::endl;
+
+    summary_file << "top-k: " << opts.top_k << std::endl;
+    summary_file << "top-k-verified: " << top.verified << std::endl;
+
+    summary_file << "top-k-e:";
+    for (auto&& c: top.components)
+      summary_file << " " << c.comp->edge_set().size();
+    summary_file << std::endl;
+
+    summary_file << "top-k-g:";
+    for (auto&& c: top.components)
+      summary_file << " " << c.comp->node_set().size();
+    summary_file << std::endl;
+  }
+
+  release_bitmap_pools<temp_edge>();
+}
+
+
+// --dt-list: the estimation sweep and the largest out-component search for
+// every dt, each on a copy of `eg' sharing its incidence index and up to
+// opts.threads of them at once. Writes one summary row per dt.
+template <template<class> class EstimatorT,
+         template<class> class ReadOnlyEstimatorT>
+void find_largest_components_dt_list(
+    const event_graph<temp_edge>& eg,
+    const options_t& opts,
+    std::ofstream& summary_file) {
+  struct dt_row {
+    size_t root_events;
+    double estimate_time, largest_time;
+    size_t loc_e, loc_g;
+    temp_time lt_begin, lt_end;
+  };
+  std::vector<dt_row> rows(opts.dt_list.size());
+
+  parallel_for(opts.dt_list.size(), opts.threads,
+      [&eg, &opts, &rows](size_t i, size_t) {
+        auto dt_eg = eg.with_expected_dt(opts.dt_list[i]);
+
+        auto estimate_start = std::chrono::steady_clock::now();
+        auto out_comp_size = estimate_out_components<
+          EstimatorT, ReadOnlyEstimatorT>(dt_eg, opts, true, 1);
+        auto estimate_end = std::chrono::steady_clock::now();
+        // the dts already run in parallel
+        auto locs = largest_out_components(dt_eg, out_comp_size,
+            opts.significance, 1);
+        auto largest_end = std::chrono::steady_clock::now();
+
+        dt_row& row = rows[i];
+        row.root_events = out_comp_size.size();
+        row.estimate_time = std::chrono::duration<double, std::milli>(
+            estimate_end-estimate_start).count();
+        row.largest_time = std::chrono::duration<double, std::milli>(
+            largest_end-estimate_end).count();
+        row.loc_e = locs.events->edge_set().size();
+        row.loc_g = locs.nodes->node_set().size();
+        std::tie(row.lt_begin, row.lt_end) = locs.lifetime->lifetime();
+      });
+  release_bitmap_pools<temp_edge>();
+
+  summary_file << "dt-columns: dt root-events estimate-wall-time "
+    "largest-search-wall-time loc-e loc-g loc-lt loc-lt-begin loc-lt-end"
+    << std::endl;
+  for (size_t i = 0; i < rows.size(); i++) {
+    const dt_row& row = rows[i];
+    summary_file << "dt-row: " << opts.dt_list[i] << " " << row.root_events
+      << " " << row.estimate_time << " " << row.largest_time
+      << " " << row.loc_e << " " << row.loc_g
+      << " " << row.lt_end - row.lt_begin
+      << " " << row.lt_begin << " " << row.lt_end << std::endl;
+  }
+}
+
+
+// --sketch-store: the main sweep runs with stored_estimator sketches, and the
+// store registers of the root events, or of all events with
+// --sketch-store-events all, are written to the store as the sweep finishes
+// them.
+template <template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+void find_largest_components_stored(
+    const event_graph<temp_edge>& eg,
+    const options_t& opts,
+    std::ofstream& summary_file) {
+  std::optional<sketch_store_writer<temp_edge, HLL_STORE_PERC>> store;
+  try {
+    store.emplace(opts.sketch_store_filename, opts.hll_seed);
+  } catch (const std::runtime_error& err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::exit(1);
+  }
+
+  find_largest_components<EstimatorT, ReadOnlyEstimatorT>(eg, opts,
+      summary_file,
+      [&store, &opts](const temp_edge& e,
+        const counter<temp_edge, EstimatorT>& comp, bool root) {
+        if (root || opts.sketch_store_all)
+          store->add(e, comp);
+      });
+
+  try {
+    store->close();
+  } catch (const std::runtime_error& err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::exit(1);
+  }
+
+  summary_file << "sketch-store-precision: " << HLL_STORE_PERC << std::endl;
+  summary_file << "sketch-store-events: " << store->size() << std::endl;
+}
+
 int main(int argc, const char* argv[]) {
   options_t opts = parse_options(argc, argv);
 
@@ -169,6 +1008,11 @@ int main(int argc, const char* argv[]) {
         opts.prob_dist_type == prob_dist_types::deterministic);
   }
 
+  if (opts.transitive_reduction)
+    eg = eg.with_transitive_reduction();
+
+  use_dense_indices(eg);
+
   summary_file << "temporal-vertices: " << eg.node_count() << std::endl;
   summary_file << "temporal-edges: " << eg.event_count() << std::endl;
 
@@ -177,69 +1021,30 @@ int main(int argc, const char* argv[]) {
   summary_file << "time-min: " << min_t << std::endl;
   summary_file << "time-max: " << max_t << std::endl;
 
+  if (opts.ensemble)
+    summary_file << "ensemble-size: "
+      << hll_ensemble_estimator<temp_edge>::ensemble_size << std::endl;
 
-  auto estimate_start = std::clock();
-  std::vector<std::pair<temp_edge, probabilistic_counter>>
-    out_comp_size = out_component_size_estimate<temp_edge>(
-        eg,
-        opts.hll_seed,
-        true); // return the estimation only for events with no predecessor
-  auto estimate_end = std::clock();
-  summary_file << "estimate-time: "
-    << (double)(1000 * (estimate_end-estimate_start))/CLOCKS_PER_SEC
-    << std::endl;
-
-  summary_file << "root-events: " << out_comp_size.size() << std::endl;
-
-  auto largest_e_start = std::clock();
-  auto loc_events =
-    largest_out_component(eg, out_comp_size, size_measures::events, opts.significance);
-  auto largest_e_end = std::clock();
-  summary_file << "largest-e-search-time: "
-    << (double)(1000 * (largest_e_end-largest_e_start))/CLOCKS_PER_SEC
-    << std::endl;
-
-  summary_file << "loc-e: " << loc_events.edge_set().size() << std::endl;
-
-
-
-  auto largest_g_start = std::clock();
-  auto loc_nodes =
-    largest_out_component(eg, out_comp_size, size_measures::nodes, opts.significance);
-  auto largest_g_end = std::clock();
-  summary_file << "largest-g-search-time: "
-    << (double)(1000 * (largest_g_end-largest_g_start))/CLOCKS_PER_SEC
-    << std::endl;
-
-  summary_file << "loc-g: " << loc_nodes.node_set().size() << std::endl;
-
-
-
-  auto largest_lt_start = std::clock();
-
-  auto max_it = out_comp_size.begin();
-  for (auto it = out_comp_size.begin(); it < out_comp_size.end(); it++) {
-    temp_time t1, t2;
-    std::tie(t1, t2) = it->second.lifetime();
-
-    temp_time max_t1, max_t2;
-    std::tie(max_t1, max_t2) = max_it->second.lifetime();
-
-    if ((max_t2 - max_t1) < (t2 - t1))
-      max_it = it;
+  if (opts.sketch_store()) {
+    if (opts.ensemble)
+      find_largest_components_stored<hll_ensemble_store_estimator,
+        hll_ensemble_store_estimator_readonly>(eg, opts, summary_file);
+    else
+      find_largest_components_stored<hll_store_estimator,
+        hll_store_estimator_readonly>(eg, opts, summary_file);
+  } else if (opts.ensemble) {
+    if (opts.dt_list.empty())
+      find_largest_components<hll_ensemble_estimator,
+        hll_ensemble_estimator_readonly>(eg, opts, summary_file);
+    else
+      find_largest_components_dt_list<hll_ensemble_estimator,
+        hll_ensemble_estimator_readonly>(eg, opts, summary_file);
+  } else {
+    if (opts.dt_list.empty())
+      find_largest_components<hll_estimator,
+        hll_estimator_readonly>(eg, opts, summary_file);
+    else
+      find_largest_components_dt_list<hll_estimator,
+        hll_estimator_readonly>(eg, opts, summary_file);
   }
-
-  auto loc_lt = out_component(eg, max_it->first,
-      (size_t)(max_it->second.node_set().estimate()*1.05),
-      (size_t)(max_it->second.edge_set().estimate()*1.05));
-  auto largest_lt_end = std::clock();
-  summary_file << "largest-lt-search-time: "
-    << (double)(1000 * (largest_lt_end-largest_lt_start))/CLOCKS_PER_SEC
-    << std::endl;
-
-  temp_time max_t1, max_t2;
-  std::tie(max_t1, max_t2) = loc_lt.lifetime();
-  summary_file << "loc-lt: " << max_t2 - max_t1 << std::endl;
-  summary_file << "loc-lt-begin: " << max_t1 << std::endl;
-  summary_file << "loc-lt-end: "   << max_t2 << std::endl;
 }
@@ -1,5 +1,16 @@
 #include <unordered_set>
 #include <cmath>
+#include <array>
+#include <algorithm>
+#include <functional>
+
+#ifndef HLL_ENSEMBLE_SIZE
+#define HLL_ENSEMBLE_SIZE 8
+#endif
+
+#ifndef EXACT_ESTIMATOR
+#define EXACT_ESTIMATOR exact_estimator
+#endif
 
 template <typename EdgeT,
          template<typename> class NodeEstimatorT,
@@ -34,6 +45,20 @@ class counter {
     max_time = std::max(max_time, e.time);
   }
 
+  // same as insert(e), for estimators keyed by dense indices: `e_idx' is the
+  // position of `e' in topo() and `vert_idx(v)' gives the index of each
+  // mutated vertex, so that searches can pass indices they already hold
+  template <class VertexIndexF>
+  void insert(const EdgeT& e, size_t e_idx, VertexIndexF vert_idx) {
+    _edge_set.insert(e, e_idx);
+
+    for (auto&& n: e.mutated_verts())
+      _node_set.insert(n, vert_idx(n));
+
+    min_time = std::min(min_time, e.time);
+    max_time = std::max(max_time, e.time);
+  }
+
   void merge(const counter<EdgeT, NodeEstimatorT, EdgeEstimatorT>& other) {
     _node_set.merge(other.node_set());
     _edge_set.merge(other.edge_set());
@@ -57,36 +82,85 @@ class counter {
   TimeType min_time, max_time;
 };
 
-template <typename T>
-class hll_estimator {
+// HyperLogLog sketch of type HllT. hll_estimator uses the precision the
+// executable was compiled with.
+template <typename T, class HllT = hll_t>
+class basic_hll_estimator {
   public:
-  hll_estimator(uint32_t seed, size_t /*size_est*/) : _estimator(true, seed) {}
+  basic_hll_estimator(uint32_t seed, size_t /*size_est*/)
+    : _estimator(true, seed) {}
 
   double estimate() const { return _estimator.estimate(); }
 
   void insert(const T& item) { _estimator.insert(item); }
 
-  void merge(const hll_estimator<T>& other) {
+  void merge(const basic_hll_estimator<T, HllT>& other) {
     _estimator.merge(other.estimator());
   }
 
-  const hll_t& estimator() const { return _estimator; }
+  const HllT& estimator() const { return _estimator; }
+
+  static double relative_error() {
+    return 1.05/pow(2.0, HllT::dense_prec/2.0);
+  }
 
   static double p_larger(double estimate, size_t limit,
       size_t max_size=std::numeric_limits<std::size_t>::max() ) {
+    return p_larger(estimate, limit, max_size, relative_error());
+  }
+
+  // same as above, for an estimate with relative standard error `sigma'
+  static double p_larger(double estimate, size_t limit,
+      size_t max_size, double sigma) {
 
     if (limit > max_size)
       return 0.0;
 
-    constexpr double cutoff = 1e-10;
+    if (estimate < (double)limit*(1-sigma*6))
+      return 0;
+
+    return posterior_p_larger(estimate, limit, max_size, sigma,
+        mass_upper_bound(max_size));
+  }
 
-    double sigma = 1.05/pow(2.0, hll_t::dense_prec/2.0);
+  // p_larger for a batch of estimates against the same limit
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return p_larger(estimates, limit, max_size, relative_error());
+  }
 
-    double p_larger = 0.0;
-    double p_total = 0.0;
+  // The checks and bounds that only depend on the limit are done once for the
+  // batch. The posterior masses themselves depend on each estimate.
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit, size_t max_size, double sigma) {
+    std::vector<double> res(estimates.size(), 0.0);
+    if (limit > max_size)
+      return res;
+
+    double zero_below = (double)limit*(1-sigma*6);
+    double upper = mass_upper_bound(max_size);
+    for (size_t i = 0; i < estimates.size(); i++)
+      if (!(estimates[i] < zero_below))
+        res[i] = posterior_p_larger(estimates[i], limit, max_size, sigma,
+            upper);
+    return res;
+  }
 
-    if (estimate < (double)limit*(1-sigma*6))
-      return 0;
+  private:
+  HllT _estimator;
+
+  // upper end of the posterior mass integrals for sizes up to `max_size'
+  static double mass_upper_bound(size_t max_size) {
+    return (max_size == std::numeric_limits<size_t>::max()) ?
+      std::numeric_limits<double>::infinity() : (double)max_size + 0.5;
+  }
+
+  // p_larger of an estimate that is not far below the limit, with `upper'
+  // from mass_upper_bound(max_size)
+  static double posterior_p_larger(double estimate, size_t limit,
+      size_t max_size, double sigma, double upper) {
+    constexpr double cutoff = 1e-10;
 
     double p_size = normal_pdf(estimate, (double)limit, sigma*(double)limit);
 
@@ -97,22 +171,34 @@ class hll_estimator {
         return 1;
     }
 
+    // posterior over integer sizes, from about 6 sigma below the estimate up
+    // to max_size, with a flat prior. Sums over sizes are taken as integrals
+    // between half-integers.
     double min_search = (1 > 6*sigma) ? estimate - 6*sigma*estimate : 1;
-    size_t i = (size_t)min_search;
-    while (i <= limit || (p_size > cutoff && i <= max_size)) {
-
-      p_size = normal_pdf(estimate, (double)i, sigma*(double)i);
-      p_total += p_size;
-      if (i > limit)
-        p_larger += p_size;
-      i++;
+
+    // a distribution only a couple of sizes wide is summed directly, as
+    // integrals are poor approximations there and the sum is short anyway
+    if (sigma*estimate < 2.0) {
+      double p_larger = 0.0;
+      double p_total = 0.0;
+      for (size_t i = (size_t)min_search;
+          i <= limit || (p_size > cutoff && i <= max_size); i++) {
+        p_size = normal_pdf(estimate, (double)i, sigma*(double)i);
+        p_total += p_size;
+        if (i > limit)
+          p_larger += p_size;
+      }
+      return p_larger/p_total;
     }
 
-    return p_larger/p_total;
-  }
+    double lower = std::max(std::floor(min_search), 1.0) - 0.5;
 
-  private:
-  hll_t _estimator;
+    double p_larger = posterior_mass(estimate, sigma, (double)limit + 0.5,
+        upper);
+    double p_total = posterior_mass(estimate, sigma, lower, upper);
+
+    return std::clamp(p_larger/p_total, 0.0, 1.0);
+  }
 
   static double normal_pdf(double x, double mean, double stddev) {
     constexpr double inv_sqrt_2pi = 0.3989422804014327;
@@ -121,15 +207,84 @@ class hll_estimator {
     return inv_sqrt_2pi/stddev*std::exp(-0.5*a*a);
   }
 
+  // Likelihood of an estimate given true size x is normal_pdf(estimate, x,
+  // sigma*x). Substituting u = (estimate/x - 1)/sigma, its integral over x
+  // becomes the integral of phi(u)/(1 + sigma*u) over u, which is expanded in
+  // powers of sigma*u over moments of the standard normal distribution. The
+  // first Euler-Maclaurin term corrects for the sum being over integers.
+  static double posterior_mass(double estimate, double sigma,
+      double from, double to) {
+    auto u = [estimate, sigma](double x) { return (estimate/x - 1.0)/sigma; };
+    auto pdf_slope = [estimate, sigma, &u](double x) {
+      if (std::isinf(x))
+        return 0.0;
+      double f = normal_pdf(estimate, x, sigma*x);
+      return f*(u(x)*estimate/(sigma*x*x) - 1.0/x);
+    };
+
+    return normal_ratio_integral(u(to), u(from), sigma) +
+      (pdf_slope(from) - pdf_slope(to))/24.0;
+  }
+
+  // integral of phi(u)/(1 + sigma*u) over [a, b]. The interval is clipped to
+  // where the expansion converges and phi is not negligible.
+  static double normal_ratio_integral(double a, double b, double sigma) {
+    constexpr double inv_sqrt_2pi = 0.3989422804014327;
+    constexpr double inv_sqrt_2 = 0.7071067811865476;
+
+    double bound = std::min(8.5, 0.9/sigma);
+    a = std::clamp(a, -bound, bound);
+    b = std::clamp(b, -bound, bound);
+    if (a >= b)
+      return 0.0;
+
+    double phi_a = inv_sqrt_2pi*std::exp(-0.5*a*a);
+    double phi_b = inv_sqrt_2pi*std::exp(-0.5*b*b);
+
+    // M_k = int_a^b u^k phi(u) du, computed from the tail nearest to the
+    // interval to avoid cancellation
+    double m_prev;
+    if (a >= 0)
+      m_prev = 0.5*(std::erfc(a*inv_sqrt_2) - std::erfc(b*inv_sqrt_2));
+    else if (b <= 0)
+      m_prev = 0.5*(std::erfc(-b*inv_sqrt_2) - std::erfc(-a*inv_sqrt_2));
+    else
+      m_prev = 1.0 - 0.5*(std::erfc(-a*inv_sqrt_2) + std::erfc(b*inv_sqrt_2));
+    double m_curr = phi_a - phi_b;
+
+    double sum = m_prev - sigma*m_curr;
+    double last_term = sigma*m_curr;
+    double a_pow = a, b_pow = b, sigma_pow = sigma*sigma;
+    for (size_t k = 2; k < 256; k++) {
+      double m_next = a_pow*phi_a - b_pow*phi_b + (double)(k-1)*m_prev;
+      double term = sigma_pow*m_next;
+      sum += term;
+      if (std::abs(term) + std::abs(last_term) < 1e-16*std::abs(sum))
+        break;
+      last_term = term;
+      m_prev = m_curr;
+      m_curr = m_next;
+      a_pow *= a;
+      b_pow *= b;
+      sigma_pow *= -sigma;
+    }
+
+    return sum;
+  }
+
 };
 
 template <typename T>
-class hll_estimator_readonly {
+using hll_estimator = basic_hll_estimator<T>;
+
+template <typename T, class HllT = hll_t>
+class basic_hll_estimator_readonly {
   public:
-  hll_estimator_readonly(uint32_t /*seed*/, size_t size_est)
+  basic_hll_estimator_readonly(uint32_t /*seed*/, size_t size_est)
     : _est((double)size_est) {}
 
-  hll_estimator_readonly(const hll_estimator<T>& hll_est) {
+  basic_hll_estimator_readonly(
+      const basic_hll_estimator<T, HllT>& hll_est) {
     _est = hll_est.estimate();
   }
 
@@ -137,19 +292,171 @@ class hll_estimator_readonly {
   void insert(const T& item) {
     throw std::logic_error("cannot insert into read-only hll estimator");
   }
-  void merge(const hll_estimator_readonly<T>& other) {
+  void merge(const basic_hll_estimator_readonly<T, HllT>& other) {
     throw std::logic_error("cannot merge read-only hll estimator");
   }
 
+  static double relative_error() {
+    return basic_hll_estimator<T, HllT>::relative_error();
+  }
+
   static double p_larger(double estimate, size_t limit,
       size_t max_size=std::numeric_limits<std::size_t>::max() ) {
-    return hll_estimator<T>::p_larger(estimate, limit, max_size);
+    return basic_hll_estimator<T, HllT>::p_larger(estimate, limit, max_size);
+  }
+
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return basic_hll_estimator<T, HllT>::p_larger(estimates, limit, max_size);
   }
 
   private:
   double _est;
 };
 
+template <typename T>
+using hll_estimator_readonly = basic_hll_estimator_readonly<T>;
+
+// K = HLL_ENSEMBLE_SIZE independently seeded HyperLogLog sketches of the same
+// set. The median of the K estimates is used as the point estimate, while the
+// spread of the estimates gives an error bar from a single sweep.
+template <typename T>
+class hll_ensemble_estimator {
+  public:
+  static constexpr size_t ensemble_size = HLL_ENSEMBLE_SIZE;
+
+  hll_ensemble_estimator(uint32_t seed, size_t /*size_est*/) {
+    _estimators.reserve(ensemble_size);
+    for (size_t i = 0; i < ensemble_size; i++)
+      _estimators.emplace_back(true, member_seed(seed, i));
+  }
+
+  std::array<double, ensemble_size> estimates() const {
+    std::array<double, ensemble_size> ests;
+    for (size_t i = 0; i < ensemble_size; i++)
+      ests[i] = _estimators[i].estimate();
+    return ests;
+  }
+
+  double estimate() const { return median(estimates()); }
+
+  void insert(const T& item) {
+    for (auto&& est: _estimators)
+      est.insert(item);
+  }
+
+  void merge(const hll_ensemble_estimator<T>& other) {
+    for (size_t i = 0; i < ensemble_size; i++)
+      _estimators[i].merge(other.estimators()[i]);
+  }
+
+  const std::vector<hll_t>& estimators() const { return _estimators; }
+
+  // relative standard error of the median of K normally distributed estimates
+  static double relative_error() {
+    constexpr double pi = 3.14159265358979323846;
+    return hll_estimator<T>::relative_error()*
+      std::sqrt(pi/(2.0*(double)ensemble_size));
+  }
+
+  static double p_larger(double estimate, size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max() ) {
+    return hll_estimator<T>::p_larger(estimate, limit, max_size,
+        relative_error());
+  }
+
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return hll_estimator<T>::p_larger(estimates, limit, max_size,
+        relative_error());
+  }
+
+  static double median(std::array<double, ensemble_size> ests) {
+    auto mid = ests.begin() + ensemble_size/2;
+    std::nth_element(ests.begin(), mid, ests.end());
+    if (ensemble_size % 2 == 1)
+      return *mid;
+    else
+      return (*mid + *std::max_element(ests.begin(), mid))/2.0;
+  }
+
+  // first member uses the original seed so that a one-member ensemble is
+  // identical to a plain hll_estimator
+  static uint32_t member_seed(uint32_t seed, size_t i) {
+    if (i == 0)
+      return seed;
+    else
+      return static_cast<uint32_t>(hll::hash(i, seed));
+  }
+
+  private:
+  std::vector<hll_t> _estimators;
+};
+
+template <typename T>
+class hll_ensemble_estimator_readonly {
+  public:
+  static constexpr size_t ensemble_size = HLL_ENSEMBLE_SIZE;
+
+  hll_ensemble_estimator_readonly(uint32_t /*seed*/, size_t size_est) {
+    _ests.fill((double)size_est);
+    _median = (double)size_est;
+  }
+
+  hll_ensemble_estimator_readonly(const hll_ensemble_estimator<T>& hll_est) {
+    _ests = hll_est.estimates();
+    _median = hll_ensemble_estimator<T>::median(_ests);
+  }
+
+  double estimate() const { return _median; }
+
+  double mean() const {
+    double sum = 0.0;
+    for (auto&& e: _ests)
+      sum += e;
+    return sum/(double)ensemble_size;
+  }
+
+  double stddev() const {
+    if (ensemble_size < 2)
+      return 0.0;
+    double m = mean(), sum_sq = 0.0;
+    for (auto&& e: _ests)
+      sum_sq += (e - m)*(e - m);
+    return std::sqrt(sum_sq/(double)(ensemble_size - 1));
+  }
+
+  const std::array<double, ensemble_size>& estimates() const { return _ests; }
+
+  void insert(const T& /*item*/) {
+    throw std::logic_error("cannot insert into read-only hll estimator");
+  }
+  void merge(const hll_ensemble_estimator_readonly<T>& /*other*/) {
+    throw std::logic_error("cannot merge read-only hll estimator");
+  }
+
+  static double relative_error() {
+    return hll_ensemble_estimator<T>::relative_error();
+  }
+
+  static double p_larger(double estimate, size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max() ) {
+    return hll_ensemble_estimator<T>::p_larger(estimate, limit, max_size);
+  }
+
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return hll_ensemble_estimator<T>::p_larger(estimates, limit, max_size);
+  }
+
+  private:
+  std::array<double, ensemble_size> _ests;
+  double _median;
+};
+
 template <typename T>
 class exact_estimator {
   public:
@@ -161,9 +468,10 @@ class exact_estimator {
   size_t size() const { return _set.size(); }
 
   void insert(const T& item) { _set.insert(item); }
+  void insert(const T& item, size_t /*index*/) { _set.insert(item); }
 
   void merge(const exact_estimator<T>& other) {
-    _set.merge(other.set());
+    _set.insert(other.set().begin(), other.set().end());
   }
 
   bool contains(const T& item) const { return _set.find(item) != _set.end(); }
@@ -173,3 +481,159 @@ class exact_estimator {
   private:
   std::unordered_set<T> _set;
 };
+
+// Exact set of items with dense integer indices, stored as a bitmap. The
+// universe size and the item to index mapping are global, shared by every
+// instance of bitmap_estimator<T>, so a process can only use bitmaps of one
+// event graph at a time. They have to be set with `set_universe` before any
+// instance is constructed. Searches pass the indices they already hold to
+// insert(item, index) and contains(item, index). insert(item) and
+// contains(item) go through the mapping, a std::function call and usually a
+// binary search, and are meant for occasional use.
+//
+// Every instance spans the whole universe, but only the words it has touched
+// are merged and cleared: bitmaps of destroyed instances are zeroed word by
+// word and reused by the next instances on the same thread, so many small
+// sets do not each pay for allocating and zeroing the universe. Each thread
+// keeps at most pool_bytes of them, and release_pool() frees those of the
+// calling thread.
+template <typename T>
+class bitmap_estimator {
+  public:
+  using index_function = std::function<size_t(const T&)>;
+
+  static void set_universe(size_t universe, index_function index) {
+    _universe = universe;
+    _index = std::move(index);
+  }
+
+  bitmap_estimator(uint32_t /*seed*/, size_t /*size_est*/) :
+    _words(acquire()) {}
+
+  bitmap_estimator(const bitmap_estimator<T>& other) :
+    _touched(other._touched), _dense(other._dense), _count(other._count) {
+    if (_dense) {
+      _words = other._words;
+    } else {
+      _words = acquire();
+      for (size_t w: _touched)
+        _words[w] = other._words[w];
+    }
+  }
+
+  bitmap_estimator(bitmap_estimator<T>&& other) noexcept :
+    _words(std::move(other._words)), _touched(std::move(other._touched)),
+    _dense(other._dense), _count(other._count) {
+    other._words.clear();
+  }
+
+  bitmap_estimator<T>& operator=(bitmap_estimator<T> other) noexcept {
+    std::swap(_words, other._words);
+    std::swap(_touched, other._touched);
+    std::swap(_dense, other._dense);
+    std::swap(_count, other._count);
+    return *this;
+  }
+
+  ~bitmap_estimator() { release(); }
+
+  size_t size() const { return _count; }
+
+  void insert(const T& item) { insert(item, _index(item)); }
+
+  void insert(const T& /*item*/, size_t i) {
+    uint64_t& word = _words[i/64];
+    uint64_t bit = uint64_t{1} << (i % 64);
+    if (!(word & bit)) {
+      if (word == 0)
+        touch(i/64);
+      word |= bit;
+      _count++;
+    }
+  }
+
+  void merge(const bitmap_estimator<T>& other) {
+    auto merge_word = [this, &other](size_t w) {
+      uint64_t before = _words[w];
+      if (before == 0 && other._words[w] != 0)
+        touch(w);
+      _words[w] |= other._words[w];
+      _count += static_cast<size_t>(__builtin_popcountll(_words[w]) -
+          __builtin_popcountll(before));
+    };
+    if (other._dense)
+      for (size_t w = 0; w < _words.size(); w++)
+        merge_word(w);
+    else
+      for (size_t w: other._touched)
+        merge_word(w);
+  }
+
+  bool contains(const T& item) const { return contains(item, _index(item)); }
+
+  bool contains(const T& /*item*/, size_t i) const {
+    return (_words[i/64] >> (i % 64)) & 1u;
+  }
+
+  static void release_pool() {
+    std::vector<std::vector<uint64_t>>().swap(pool());
+  }
+
+  // bytes of zeroed bitmaps kept for reuse by each thread. Bitmaps of
+  // universes larger than this are not kept at all.
+  static constexpr size_t pool_bytes = size_t(32) << 20;
+
+  private:
+  inline static size_t _universe = 0;
+  inline static index_function _index;
+
+  static std::vector<std::vector<uint64_t>>& pool() {
+    thread_local std::vector<std::vector<uint64_t>> bitmaps;
+    return bitmaps;
+  }
+
+  static std::vector<uint64_t> acquire() {
+    size_t words = (_universe + 63)/64;
+    auto& bitmaps = pool();
+    while (!bitmaps.empty()) {
+      std::vector<uint64_t> reused = std::move(bitmaps.back());
+      bitmaps.pop_back();
+      if (reused.size() == words)
+        return reused;
+    }
+    return std::vector<uint64_t>(words, 0);
+  }
+
+  void release() {
+    auto& bitmaps = pool();
+    if (_words.empty() ||
+        (bitmaps.size() + 1)*_words.size()*sizeof(uint64_t) > pool_bytes)
+      return;
+    if (_dense)
+      std::fill(_words.begin(), _words.end(), 0);
+    else
+      for (size_t w: _touched)
+        _words[w] = 0;
+    bitmaps.push_back(std::move(_words));
+    _words.clear();
+  }
+
+  // records that word `w' became non-zero. Once more than a sixteenth of the
+  // words are touched, whole-bitmap passes are cheaper than the list.
+  void touch(size_t w) {
+    if (_dense)
+      return;
+    if (_touched.size() >= _words.size()/16) {
+      _dense = true;
+      _touched.clear();
+      _touched.shrink_to_fit();
+    } else {
+      _touched.push_back(w);
+    }
+  }
+
+  std::vector<uint64_t> _words;
+  std::vector<size_t> _touched;
+  bool _dense = false;
+  size_t _count = 0;
+};
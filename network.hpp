@@ -1,8 +1,11 @@
 #include <iostream>
 #include <fstream>
 #include <limits>
+#include <sstream>
+#include <tuple>
 
-#include <disjoint_set.hpp>
+#include "parallel.hpp"
+#include "concurrent_disjoint_set.hpp"
 
 
 template <class EdgeT>
@@ -24,50 +27,348 @@ std::vector<EdgeT> event_list(std::string net_filename,
 }
 
 
+// parses a comma separated list such as "1,2.5,10". Returns an empty vector if
+// any of the items is malformed.
+template <class T>
+std::vector<T> parse_list(const std::string& text) {
+  std::vector<T> values;
+  std::istringstream list(text);
+  std::string item;
+  while (std::getline(list, item, ',')) {
+    std::istringstream item_stream(item);
+    T value;
+    if (!(item_stream >> value) || !(item_stream >> std::ws).eof())
+      return {};
+    values.push_back(value);
+  }
+  return values;
+}
+
+
+// Weakly connected components of the event graph computed with `threads'
+// workers, each merging a chunk of topo() with the successors of its events.
+// Returns the component id of every event in topo() order, where the id is the
+// index of the earliest event of the component.
+template <class EdgeT>
+std::vector<size_t>
+weakly_connected_component_ids(const event_graph<EdgeT>& eg, size_t threads) {
+  constexpr size_t chunk = 1024;
+  const auto& topo = eg.topo();
+
+  concurrent_disjoint_set disj_set(topo.size());
+
+  parallel_for(topo.size(), threads,
+      [&eg, &topo, &disj_set](size_t temp_edge_idx, size_t) {
+        auto temp_edge_iter = topo.begin() + (std::ptrdiff_t)temp_edge_idx;
+        for (auto&& other: eg.successors(*temp_edge_iter)) {
+          auto other_it = std::lower_bound(temp_edge_iter+1, topo.end(), other);
+          disj_set.merge(temp_edge_idx,
+              (size_t)std::distance(topo.begin(), other_it));
+        }
+      }, chunk);
+
+  std::vector<size_t> ids(topo.size());
+  parallel_for(topo.size(), threads,
+      [&ids, &disj_set](size_t i, size_t) {
+        ids[i] = disj_set.component_id(i);
+      }, chunk);
+
+  return ids;
+}
+
+// Same component ids as weakly_connected_component_ids() for the
+// deterministic adjacency, where b follows a iff they share a vertex and
+// 0 < b.time - a.effect_time() < expected_dt(). Instead of enumerating
+// successors, every vertex is processed once: each event reaching it is merged
+// with the first event leaving it within dt, and consecutive leaving events
+// that are both reached by some arriving event are merged with each other.
+template <class EdgeT>
+std::vector<size_t>
+deterministic_weakly_connected_component_ids(
+    const event_graph<EdgeT>& eg, size_t threads) {
+  using TimeType = typename EdgeT::TimeType;
+
+  const auto& topo = eg.topo();
+  const TimeType dt = eg.expected_dt();
+
+  std::vector<std::pair<const std::vector<EdgeT>*, const std::vector<EdgeT>*>>
+    incidences;
+  incidences.reserve(eg.in_incidence().size());
+  for (auto&& p: eg.in_incidence()) {
+    auto out = eg.out_incidence().find(p.first);
+    if (out != eg.out_incidence().end())
+      incidences.emplace_back(&p.second, &out->second);
+  }
+
+  concurrent_disjoint_set disj_set(topo.size());
+
+  parallel_for(incidences.size(), threads,
+      [&eg, &incidences, &disj_set, dt](size_t v_idx, size_t) {
+        const auto& in = *incidences[v_idx].first;
+        const auto& out = *incidences[v_idx].second;
+
+        std::vector<size_t> out_idx(out.size());
+        for (size_t j = 0; j < out.size(); j++)
+          out_idx[j] = eg.event_index(out[j]);
+
+        // linked[j] > 0 iff out[j] and out[j+1] have a common predecessor
+        std::vector<long> linked(out.size(), 0);
+
+        // `in' is sorted by effect time, so the window [l, r) of successors
+        // on this vertex only moves forward
+        size_t l = 0, r = 0;
+        for (auto&& a: in) {
+          while (l < out.size() && !(out[l].time > a.effect_time()))
+            l++;
+          r = std::max(r, l);
+          while (r < out.size() && out[r].time - a.effect_time() < dt)
+            r++;
+
+          if (l < r) {
+            disj_set.merge(eg.event_index(a), out_idx[l]);
+            linked[l]++;
+            linked[r-1]--;
+          }
+        }
+
+        long running = 0;
+        for (size_t j = 0; j + 1 < out.size(); j++) {
+          running += linked[j];
+          if (running > 0)
+            disj_set.merge(out_idx[j], out_idx[j+1]);
+        }
+      });
+
+  std::vector<size_t> ids(topo.size());
+  parallel_for(topo.size(), threads,
+      [&ids, &disj_set](size_t i, size_t) {
+        ids[i] = disj_set.component_id(i);
+      }, 1024);
+
+  return ids;
+}
+
+// Relabels component ids returned by weakly_connected_component_ids() and
+// deterministic_weakly_connected_component_ids() to the dense range
+// [0, count) in order of the earliest event of each component and returns
+// count. Relies on every component id being the index of its earliest event.
+inline size_t compact_component_ids(std::vector<size_t>& ids) {
+  size_t count = 0;
+  for (size_t i = 0; i < ids.size(); i++) {
+    if (ids[i] == i)
+      ids[i] = count++;
+    else
+      ids[i] = ids[ids[i]];
+  }
+  return count;
+}
+
+template <class TimeT>
+struct component_stats {
+  size_t events = 0, vertices = 0;
+  TimeT begin, end;
+};
+
+// number of events, number of distinct mutated vertices and lifetime (as in
+// counter) of each of the `count' components of dense `ids', in one parallel
+// pass over events and one over vertices.
 template <class EdgeT>
-std::vector<std::vector<EdgeT>>
-weakly_connected_components(const event_graph<EdgeT>& eg, bool singletons=false) {
+std::vector<component_stats<typename EdgeT::TimeType>>
+aggregate_component_stats(const event_graph<EdgeT>& eg,
+    const std::vector<size_t>& ids, size_t count, size_t threads) {
+  using TimeType = typename EdgeT::TimeType;
+  constexpr size_t chunk = 1024;
 
-  size_t log_increment = eg.topo().size()/20;
+  const auto& topo = eg.topo();
 
-  auto disj_set = ds::disjoint_set<size_t>(eg.topo().size());
+  std::vector<std::atomic<size_t>> events(count), vertices(count);
+  std::vector<std::atomic<TimeType>> begin(count), end(count);
+  for (size_t c = 0; c < count; c++) {
+    events[c].store(0, std::memory_order_relaxed);
+    vertices[c].store(0, std::memory_order_relaxed);
+    begin[c].store(std::numeric_limits<TimeType>::max(),
+        std::memory_order_relaxed);
+    end[c].store(std::numeric_limits<TimeType>::lowest(),
+        std::memory_order_relaxed);
+  }
 
-  auto temp_edge_iter = eg.topo().begin();
-  while (temp_edge_iter < eg.topo().end()) {
-    size_t temp_edge_idx = std::distance(eg.topo().begin(), temp_edge_iter);
+  parallel_for(topo.size(), threads,
+      [&topo, &ids, &events, &begin, &end](size_t i, size_t) {
+        size_t c = ids[i];
+        events[c].fetch_add(1, std::memory_order_relaxed);
+        atomic_min(begin[c], topo[i].time);
+        atomic_max(end[c], topo[i].time);
+      }, chunk);
 
-    if (log_increment > 10'000 && temp_edge_idx % log_increment == 0)
-      std::cerr << temp_edge_idx*100/eg.topo().size() <<
-        "\% processed (weakly)" << std::endl;
+  std::vector<const std::vector<EdgeT>*> incidences;
+  incidences.reserve(eg.in_incidence().size());
+  for (auto&& p: eg.in_incidence())
+    incidences.push_back(&p.second);
 
-    for (auto&& other: eg.successors(*temp_edge_iter)) {
+  // a vertex counts once towards every component that has an event mutating
+  // it
+  parallel_for(incidences.size(), threads,
+      [&eg, &ids, &incidences, &vertices](size_t v_idx, size_t) {
+        std::vector<size_t> comps;
+        comps.reserve(incidences[v_idx]->size());
+        for (auto&& e: *incidences[v_idx])
+          comps.push_back(ids[eg.event_index(e)]);
+        std::sort(comps.begin(), comps.end());
+        comps.erase(std::unique(comps.begin(), comps.end()), comps.end());
+        for (size_t c: comps)
+          vertices[c].fetch_add(1, std::memory_order_relaxed);
+      });
 
+  std::vector<component_stats<TimeType>> stats(count);
+  for (size_t c = 0; c < count; c++) {
+    stats[c].events = events[c].load();
+    stats[c].vertices = vertices[c].load();
+    stats[c].begin = begin[c].load();
+    stats[c].end = end[c].load();
+  }
 
-      /// We are benefiting from the fact that successors are always after the
-      /// original event. Might consider searching linearly for caching or small
-      /// networks?
-      // auto other_it = std::find(temp_edge_iter+1, eg.topo().end(), other);
-      auto other_it = std::lower_bound(temp_edge_iter+1, eg.topo().end(), other);
+  return stats;
+}
 
+// The links used by deterministic_weakly_connected_component_ids() as
+// (gap, event index, event index), sorted by gap, independent of
+// expected_dt(). Merging every link with gap < dt gives the weakly connected
+// components of the deterministic event graph with maximum dt `dt'. The gap of
+// the link between consecutive leaving events is that of the latest arriving
+// event that reaches both.
+template <class EdgeT>
+std::vector<std::tuple<typename EdgeT::TimeType, size_t, size_t>>
+deterministic_link_gaps(const event_graph<EdgeT>& eg) {
+  std::vector<std::tuple<typename EdgeT::TimeType, size_t, size_t>> links;
+
+  for (auto&& p: eg.in_incidence()) {
+    auto out_it = eg.out_incidence().find(p.first);
+    if (out_it == eg.out_incidence().end())
+      continue;
+    const auto& in = p.second;
+    const auto& out = out_it->second;
 
-      size_t other_idx = std::distance(eg.topo().begin(), other_it);
-      disj_set.merge(temp_edge_idx, other_idx);
+    size_t l = 0;
+    for (auto&& a: in) {
+      while (l < out.size() && !(out[l].time > a.effect_time()))
+        l++;
+      if (l < out.size())
+        links.emplace_back(out[l].time - a.effect_time(),
+            eg.event_index(a), eg.event_index(out[l]));
     }
 
-    temp_edge_iter++;
+    // `last' is one past the latest arriving event taking effect before
+    // out[j]
+    size_t last = 0;
+    for (size_t j = 0; j + 1 < out.size(); j++) {
+      while (last < in.size() && in[last].effect_time() < out[j].time)
+        last++;
+      if (last > 0)
+        links.emplace_back(out[j+1].time - in[last-1].effect_time(),
+            eg.event_index(out[j]), eg.event_index(out[j+1]));
+    }
   }
 
-  auto sets = disj_set.sets(singletons);
-  std::vector<std::vector<EdgeT>> sets_vector;
-  sets_vector.reserve(sets.size());
+  std::sort(links.begin(), links.end());
+  return links;
+}
+
+// Weakly connected components of the deterministic event graph for every
+// maximum dt in `dts' from a single pass over deterministic_link_gaps(), adding
+// links to one union-find in increasing order of gap. Calls `f(dt, ids, count)'
+// in increasing order of dt with the component ids of the events, compacted as
+// in compact_component_ids(), and the number of components.
+template <class EdgeT, class Function>
+void dt_percolation_ids(const event_graph<EdgeT>& eg,
+    std::vector<typename EdgeT::TimeType> dts, size_t threads, Function f) {
+  std::sort(dts.begin(), dts.end());
+
+  auto links = deterministic_link_gaps(eg);
+  concurrent_disjoint_set disj_set(eg.event_count());
 
-  for (const auto& p: sets) {
-    sets_vector.emplace_back();
-    auto& current_set = sets_vector.back();
-    current_set.reserve(p.second.size());
-    for (const auto& event_idx: p.second)
-      current_set.push_back(eg.topo().at(event_idx));
+  std::vector<size_t> ids(eg.event_count());
+  auto link = links.begin();
+  for (auto dt: dts) {
+    for (; link < links.end() && std::get<0>(*link) < dt; link++)
+      disj_set.merge(std::get<1>(*link), std::get<2>(*link));
+
+    parallel_for(ids.size(), threads,
+        [&ids, &disj_set](size_t i, size_t) {
+          ids[i] = disj_set.component_id(i);
+        }, 1024);
+    size_t count = compact_component_ids(ids);
+
+    f(dt, static_cast<const std::vector<size_t>&>(ids), count);
   }
+}
+
+// Same as dt_percolation_ids(), calling `f(dt, stats)' with
+// aggregate_component_stats() of the components instead.
+template <class EdgeT, class Function>
+void dt_percolation(const event_graph<EdgeT>& eg,
+    std::vector<typename EdgeT::TimeType> dts, size_t threads, Function f) {
+  dt_percolation_ids(eg, std::move(dts), threads,
+      [&eg, threads, &f](typename EdgeT::TimeType dt,
+        const std::vector<size_t>& ids, size_t count) {
+        f(dt, aggregate_component_stats(eg, ids, count, threads));
+      });
+}
+
+// Maximal chains of the event graph: runs of events where each event has a
+// single successor and that successor has a single predecessor. Every event
+// belongs to exactly one chain. Indices are positions in topo().
+struct event_chains {
+  static constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+  // next event of the same chain, or npos for the last event of a chain
+  std::vector<size_t> next;
+  // number of predecessors of each event
+  std::vector<size_t> in_degree;
+  // non-zero for the first event of each chain
+  std::vector<char> head;
+  size_t chain_count = 0;
+};
+
+template <class EdgeT>
+event_chains find_event_chains(const event_graph<EdgeT>& eg, size_t threads) {
+  constexpr size_t chunk = 1024;
+  const auto& topo = eg.topo();
+
+  event_chains chains;
+  chains.next.resize(topo.size(), event_chains::npos);
+  chains.in_degree.resize(topo.size());
+  chains.head.resize(topo.size(), 1);
+
+  // in-degrees are counted from the successor lists, so that they agree with
+  // the links a sweep over successors() sees
+  std::vector<std::atomic<size_t>> in_degree(topo.size());
+  parallel_for(topo.size(), threads,
+      [&eg, &topo, &chains, &in_degree](size_t i, size_t) {
+        auto succ = eg.successors(topo[i]);
+        for (auto&& s: succ)
+          in_degree[eg.event_index(s)].fetch_add(1,
+              std::memory_order_relaxed);
+        if (succ.size() == 1)
+          chains.next[i] = eg.event_index(succ.front());
+      }, chunk);
+
+  parallel_for(topo.size(), threads,
+      [&chains, &in_degree](size_t i, size_t) {
+        chains.in_degree[i] = in_degree[i].load(std::memory_order_relaxed);
+      }, chunk);
+
+  // a successor with a single predecessor has only one event linking to it,
+  // so these writes never collide
+  parallel_for(topo.size(), threads,
+      [&chains](size_t i, size_t) {
+        size_t next = chains.next[i];
+        if (next != event_chains::npos && chains.in_degree[next] != 1)
+          chains.next[i] = event_chains::npos;
+        else if (next != event_chains::npos)
+          chains.head[next] = 0;
+      }, chunk);
 
-  return sets_vector;
+  chains.chain_count = (size_t)std::count(
+      chains.head.begin(), chains.head.end(), 1);
+  return chains;
 }
@@ -2,6 +2,8 @@
 #include <fstream>
 #include <vector>
 #include <ctime>
+#include <chrono>
+#include <sstream>
 
 #include <hyperloglog.hpp>
 #include <dag.hpp>
@@ -31,6 +33,7 @@ enum class prob_dist_types { deterministic, exponential };
 #include "event_graph.hpp"
 #include "network.hpp"
 #include "out_component_size_estimate.hpp"
+#include "in_component_size_estimate.hpp"
 
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wconversion"
@@ -63,6 +66,26 @@ cxxopts::Options define_options() {
      cxxopts::value<double>()->default_value("0.001"))
     ("exponential",
      "exponentially decay probably of a link in event graph w.r.t. time")
+    ("ensemble",
+     "carry an ensemble of independently seeded HyperLogLog sketches per "
+     "event and report mean and standard deviation of the estimates")
+    ("threads",
+     "number of threads used to find weakly connected components (0 means all "
+     "available)",
+     cxxopts::value<size_t>()->default_value("0"))
+    ("in-components",
+     "also estimate in-components of all events and find the exact "
+     "in-component of the event with the largest estimate")
+    ("dt-list",
+     "comma separated list of dt values. Estimates out-components for each "
+     "of them on one shared event graph, up to --threads of them at once, "
+     "writing one summary row per dt and prefixing --out-component-sizes "
+     "lines with the dt",
+     cxxopts::value<std::string>())
+    ("percolation-dts",
+     "comma separated list of dt values at which to report weakly connected "
+     "components in --percolation-sizes (deterministic prob-dist only)",
+     cxxopts::value<std::string>())
     ("h,help", "Print help")
     ;
 
@@ -78,9 +101,16 @@ cxxopts::Options define_options() {
      cxxopts::value<std::string>())
     ("out-component-sizes", "file to store out-component sizes of all events",
      cxxopts::value<std::string>())
+    ("in-component-sizes", "file to store in-component sizes of all events "
+     "(implies --in-components)",
+     cxxopts::value<std::string>())
     ("weakly-component-sizes", "file to store weakly connected component "
      "distributions of the network",
      cxxopts::value<std::string>())
+    ("percolation-sizes", "file to store the number of weakly connected "
+     "components and the largest weakly connected component for each of "
+     "--percolation-dts",
+     cxxopts::value<std::string>())
     ;
   return options;
 }
@@ -126,11 +156,24 @@ struct options_t {
     }
     std::string out_comps_filename;
 
+    bool in_comps_file() {
+      return !in_comps_filename.empty();
+    }
+    std::string in_comps_filename;
+    bool in_components = false;
+
     bool weakly_comps_file() {
       return !weakly_comps_filename.empty();
     }
     std::string weakly_comps_filename;
 
+    bool percolation_file() {
+      return !percolation_filename.empty();
+    }
+    std::string percolation_filename;
+    std::vector<temp_time> percolation_dts;
+    std::vector<temp_time> dt_list;
+
     size_t temporal_reserve = 0;
     std::string network_filename;
 
@@ -142,6 +185,10 @@ struct options_t {
 
     double significance;
 
+    bool ensemble = false;
+
+    size_t threads = 0;
+
     temp_time dt;
 };
 
@@ -211,9 +258,45 @@ options_t parse_options(int argc, const char* argv[]) {
   if (options.count("weakly-component-sizes") != 0)
     opts.weakly_comps_filename = options["weakly-component-sizes"].as<std::string>();
 
+  if (options.count("percolation-sizes") != 0)
+    opts.percolation_filename = options["percolation-sizes"].as<std::string>();
+
+  if (options.count("dt-list") != 0) {
+    opts.dt_list = parse_list<temp_time>(options["dt-list"].as<std::string>());
+    if (opts.dt_list.empty()) {
+      std::cerr << "ERROR: dt-list should be a comma separated list of dt "
+        "values" << std::endl;
+      std::cerr << option_defs.help({"", "Event List File", "Output"})
+        << std::endl;
+      std::exit(1);
+    }
+  }
+
+  if (options.count("percolation-dts") != 0) {
+    opts.percolation_dts = parse_list<temp_time>(
+        options["percolation-dts"].as<std::string>());
+    if (opts.percolation_dts.empty()) {
+      std::cerr << "ERROR: percolation-dts should be a comma separated list "
+        "of dt values" << std::endl;
+      std::cerr << option_defs.help({"", "Event List File", "Output"})
+        << std::endl;
+      std::exit(1);
+    }
+  }
+
   if (options.count("out-component-sizes") != 0)
     opts.out_comps_filename = options["out-component-sizes"].as<std::string>();
 
+  if (options.count("in-component-sizes") != 0)
+    opts.in_comps_filename = options["in-component-sizes"].as<std::string>();
+
+  opts.in_components = options["in-components"].as<bool>() ||
+    opts.in_comps_file();
+
+  opts.ensemble = options["ensemble"].as<bool>();
+
+  opts.threads = options["threads"].as<size_t>();
+
   opts.dt = options["dt"].as<temp_time>();
 
   if (options["prob-dist"].as<std::string>() == "deterministic") {
@@ -230,19 +313,35 @@ options_t parse_options(int argc, const char* argv[]) {
     std::exit(1);
   }
 
+  if (!opts.percolation_dts.empty()
+      && opts.prob_dist_type != prob_dist_types::deterministic) {
+    std::cerr << "ERROR: percolation-dts needs the deterministic prob-dist"
+      << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
   return opts;
 }
 
 template <class EdgeT>
 void log_weakly_component_sizes(
     const event_graph<EdgeT>& eg,
+    bool deterministic,
+    size_t threads,
     std::ofstream& summary_file,
     std::ofstream& weakly_comps_file) {
 
   using TimeType =  typename EdgeT::TimeType;
 
   auto weakly_start = std::clock();
-  auto weakly_comps = weakly_connected_components(eg, true);
+  std::vector<size_t> comp_ids = deterministic ?
+    deterministic_weakly_connected_component_ids(eg, threads) :
+    weakly_connected_component_ids(eg, threads);
+  size_t comp_count = compact_component_ids(comp_ids);
+  auto comp_stats = aggregate_component_stats(eg, comp_ids, comp_count,
+      threads);
   auto weakly_end = std::clock();
   summary_file << "weakly-time: "
     << (double)(1000 * (weakly_end-weakly_start))/CLOCKS_PER_SEC
@@ -252,28 +351,235 @@ void log_weakly_component_sizes(
          g_max = std::numeric_limits<size_t>::lowest();
   TimeType lt_max = std::numeric_limits<TimeType>::lowest();
 
+  for (auto&& c: comp_stats) {
+    e_max = std::max(c.events, e_max);
+    g_max = std::max(c.vertices, g_max);
+    lt_max = std::max(c.end - c.begin, lt_max);
 
-  for (auto&& w: weakly_comps) {
-    counter<EdgeT, exact_estimator> c(0, w.size(), w.size()/2);
-    for (auto&& e: w)
-      c.insert(e);
+    weakly_comps_file << c.events << " "
+      << c.vertices << " " << c.begin << " " << c.end << "\n";
+  }
+
+  summary_file << "largest-weakly-e: " << e_max << std::endl;
+  summary_file << "largest-weakly-g: " << g_max << std::endl;
+  summary_file << "largest-weakly-lt: " << lt_max << std::endl;
+}
+
+template <typename T>
+void write_estimate(std::ostream& out, const hll_estimator_readonly<T>& est) {
+  out << est.estimate();
+}
+
+template <typename T>
+void write_estimate(std::ostream& out,
+    const hll_ensemble_estimator_readonly<T>& est) {
+  out << est.estimate() << " " << est.mean() << " " << est.stddev();
+}
+
+template <class TimeT>
+struct largest_estimates {
+  double e_max = std::numeric_limits<double>::lowest(),
+         g_max = std::numeric_limits<double>::lowest();
+  TimeT lt_max = std::numeric_limits<TimeT>::lowest();
+  TimeT start_max = std::numeric_limits<TimeT>::max(),
+        end_max = std::numeric_limits<TimeT>::lowest();
+};
 
+// writes one line per estimated out- or in-component to comps_file, starting
+// with `prefix', and returns the largest estimates
+template <class EdgeT, template<typename> class ReadOnlyEstimatorT>
+largest_estimates<typename EdgeT::TimeType> write_component_sizes(
+    const std::vector<std::pair<EdgeT,
+      counter<EdgeT, ReadOnlyEstimatorT>>>& comp_size,
+    const std::string& prefix,
+    std::ofstream& comps_file) {
+  using TimeType =  typename EdgeT::TimeType;
+
+  largest_estimates<TimeType> largest;
+  for (auto&& p: comp_size) {
     TimeType start, end;
-    std::tie(start, end) = c.lifetime();
+    std::tie(start, end) = p.second.lifetime();
 
-    e_max = std::max(c.edge_set().size(), e_max);
-    g_max = std::max(c.node_set().size(), g_max);
-    lt_max = std::max(end - start, lt_max);
+    largest.e_max = std::max(p.second.edge_set().estimate(), largest.e_max);
+    largest.g_max = std::max(p.second.node_set().estimate(), largest.g_max);
+    if ((end - start) > largest.lt_max) {
+      largest.lt_max = std::max(end - start, largest.lt_max);
+      largest.start_max = start;
+      largest.end_max = end;
+    }
 
-    weakly_comps_file << c.edge_set().size() << " "
-      << c.node_set().size() << " " << start << " " << end << "\n";
+    comps_file << prefix;
+    write_estimate(comps_file, p.second.edge_set());
+    comps_file << " ";
+    write_estimate(comps_file, p.second.node_set());
+    comps_file << " " << start << " " << end << "\n";
   }
 
-  summary_file << "largest-weakly-e: " << e_max << std::endl;
-  summary_file << "largest-weakly-g: " << g_max << std::endl;
-  summary_file << "largest-weakly-lt: " << lt_max << std::endl;
+  return largest;
 }
 
+template <class EdgeT,
+         template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+void log_out_component_sizes(
+    const event_graph<EdgeT>& eg,
+    uint32_t hll_seed,
+    std::ofstream& summary_file,
+    std::ofstream& out_comps_file) {
+
+  auto estimation_start = std::clock();
+  std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+    out_comp_size = out_component_size_estimate<EdgeT,
+      EstimatorT, ReadOnlyEstimatorT>(
+        eg, hll_seed, false); // return the estimation for all events
+  auto estimation_end = std::clock();
+  summary_file << "estimation-time: "
+    << (double)(1000 * (estimation_end-estimation_start))/CLOCKS_PER_SEC
+    << std::endl;
+
+  auto largest = write_component_sizes(out_comp_size, "", out_comps_file);
+
+  summary_file << "largest-out-e: " << largest.e_max << std::endl;
+  summary_file << "largest-out-g: " << largest.g_max << std::endl;
+  summary_file << "largest-out-lt: " << largest.lt_max << std::endl;
+
+  summary_file << "loc-lt-begin: " << largest.start_max << std::endl;
+  summary_file << "loc-lt-end: "   << largest.end_max << std::endl;
+}
+
+template <class EdgeT,
+         template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+void log_in_component_sizes(
+    const event_graph<EdgeT>& eg,
+    uint32_t hll_seed,
+    std::ofstream& summary_file,
+    std::ofstream& in_comps_file) {
+
+  auto estimation_start = std::clock();
+  std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+    in_comp_size = in_component_size_estimate<EdgeT,
+      EstimatorT, ReadOnlyEstimatorT>(
+        eg, hll_seed, false); // return the estimation for all events
+  auto estimation_end = std::clock();
+  summary_file << "in-estimation-time: "
+    << (double)(1000 * (estimation_end-estimation_start))/CLOCKS_PER_SEC
+    << std::endl;
+
+  auto largest = write_component_sizes(in_comp_size, "", in_comps_file);
+
+  summary_file << "largest-in-e: " << largest.e_max << std::endl;
+  summary_file << "largest-in-g: " << largest.g_max << std::endl;
+  summary_file << "largest-in-lt: " << largest.lt_max << std::endl;
+
+  summary_file << "lic-lt-begin: " << largest.start_max << std::endl;
+  summary_file << "lic-lt-end: "   << largest.end_max << std::endl;
+
+  if (in_comp_size.empty())
+    return;
+
+  // exact in-component of the event with the largest estimate
+  auto max_it = std::max_element(in_comp_size.begin(), in_comp_size.end(),
+      [](const auto& a, const auto& b) {
+        return a.second.edge_set().estimate() < b.second.edge_set().estimate();
+      });
+  auto exact_start = std::clock();
+  auto lic = in_component(eg, max_it->first,
+      (size_t)max_it->second.node_set().estimate(),
+      (size_t)max_it->second.edge_set().estimate());
+  auto exact_end = std::clock();
+  summary_file << "lic-exact-time: "
+    << (double)(1000 * (exact_end-exact_start))/CLOCKS_PER_SEC
+    << std::endl;
+  summary_file << "lic-e: " << lic.edge_set().size() << std::endl;
+  summary_file << "lic-g: " << lic.node_set().size() << std::endl;
+}
+
+// --dt-list: estimates out-components for every dt in `dts' on copies of `eg'
+// sharing its incidence index, `threads' dts at a time. Lines of
+// out_comps_file and one summary row per dt start with the dt.
+template <class EdgeT,
+         template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT>
+void log_out_component_sizes_dt_list(
+    const event_graph<EdgeT>& eg,
+    const std::vector<typename EdgeT::TimeType>& dts,
+    uint32_t hll_seed,
+    size_t threads,
+    std::ofstream& summary_file,
+    std::ofstream& out_comps_file) {
+  using out_comp_sizes = std::vector<std::pair<EdgeT,
+        counter<EdgeT, ReadOnlyEstimatorT>>>;
+
+  summary_file << "dt-columns: dt estimation-wall-time largest-out-e "
+    "largest-out-g largest-out-lt loc-lt-begin loc-lt-end" << std::endl;
+
+  // estimates of every event are kept until written, so only a batch of dts
+  // is in memory at once
+  size_t batch = worker_count(threads);
+  for (size_t first = 0; first < dts.size(); first += batch) {
+    size_t count = std::min(batch, dts.size() - first);
+    std::vector<out_comp_sizes> results(count);
+    std::vector<double> times(count);
+
+    parallel_for(count, threads,
+        [&eg, &dts, &results, &times, hll_seed, first](size_t i, size_t) {
+          auto dt_eg = eg.with_expected_dt(dts[first + i]);
+          auto estimation_start = std::chrono::steady_clock::now();
+          results[i] = out_component_size_estimate<EdgeT,
+            EstimatorT, ReadOnlyEstimatorT>(dt_eg, hll_seed, false);
+          auto estimation_end = std::chrono::steady_clock::now();
+          times[i] = std::chrono::duration<double, std::milli>(
+              estimation_end-estimation_start).count();
+        });
+
+    for (size_t i = 0; i < count; i++) {
+      std::ostringstream prefix;
+      prefix << dts[first + i] << " ";
+      auto largest = write_component_sizes(results[i], prefix.str(),
+          out_comps_file);
+      results[i] = out_comp_sizes();
+
+      summary_file << "dt-row: " << dts[first + i] << " " << times[i]
+        << " " << largest.e_max << " " << largest.g_max
+        << " " << largest.lt_max << " " << largest.start_max
+        << " " << largest.end_max << std::endl;
+    }
+  }
+}
+
+
+template <class EdgeT>
+void log_dt_percolation(
+    const event_graph<EdgeT>& eg,
+    const std::vector<typename EdgeT::TimeType>& dts,
+    size_t threads,
+    std::ofstream& summary_file,
+    std::ofstream& percolation_file) {
+  using TimeType =  typename EdgeT::TimeType;
+
+  auto percolation_start = std::clock();
+  dt_percolation(eg, dts, threads,
+      [&percolation_file](TimeType dt,
+        const std::vector<component_stats<TimeType>>& comp_stats) {
+        size_t e_max = 0, g_max = 0;
+        TimeType lt_max = std::numeric_limits<TimeType>::lowest();
+        for (auto&& c: comp_stats) {
+          e_max = std::max(c.events, e_max);
+          g_max = std::max(c.vertices, g_max);
+          lt_max = std::max(c.end - c.begin, lt_max);
+        }
+
+        percolation_file << dt << " " << comp_stats.size() << " "
+          << e_max << " " << g_max << " " << lt_max << "\n";
+      });
+  auto percolation_end = std::clock();
+  summary_file << "percolation-time: "
+    << (double)(1000 * (percolation_end-percolation_start))/CLOCKS_PER_SEC
+    << std::endl;
+}
+
+
 int main(int argc, const char* argv[]) {
   options_t opts = parse_options(argc, argv);
 
@@ -309,18 +615,19 @@ int main(int argc, const char* argv[]) {
   summary_file << "time-min: " << min_t << std::endl;
   summary_file << "time-max: " << max_t << std::endl;
 
-  log_weakly_component_sizes(eg, summary_file, weakly_comps_file);
-
-  using probabilistic_counter = counter<temp_edge, hll_estimator_readonly>;
-  auto estimation_start = std::clock();
-  std::vector<std::pair<temp_edge, probabilistic_counter>>
-    out_comp_size = out_component_size_estimate<temp_edge>(
-        eg, opts.hll_seed, false); // return the estimation for all events
-  auto estimation_end = std::clock();
-  summary_file << "estimation-time: "
-    << (double)(1000 * (estimation_end-estimation_start))/CLOCKS_PER_SEC
-    << std::endl;
-
+  log_weakly_component_sizes(eg,
+      opts.prob_dist_type == prob_dist_types::deterministic, opts.threads,
+      summary_file, weakly_comps_file);
+
+  if (!opts.percolation_dts.empty()) {
+    std::ofstream percolation_file;
+    if (opts.percolation_file())
+      percolation_file.open(opts.percolation_filename);
+    else
+      percolation_file.basic_ios<char>::rdbuf(&null_buf); // nope nope nope
+    log_dt_percolation(eg, opts.percolation_dts, opts.threads, summary_file,
+        percolation_file);
+  }
 
   std::ofstream out_comps_file;
   if (opts.out_comps_file())
@@ -328,33 +635,44 @@ int main(int argc, const char* argv[]) {
   else
     out_comps_file.basic_ios<char>::rdbuf(&null_buf); // nope nope nope
 
-  double e_max = std::numeric_limits<double>::lowest(),
-         g_max = std::numeric_limits<double>::lowest();
-  temp_time lt_max = std::numeric_limits<temp_time>::lowest();
-  temp_time start_max = std::numeric_limits<temp_time>::max(),
-            end_max = std::numeric_limits<temp_time>::lowest();
-
-  for (auto&& p: out_comp_size) {
-    temp_time start, end;
-    std::tie(start, end) = p.second.lifetime();
-
-    e_max = std::max(p.second.edge_set().estimate(), e_max);
-    g_max = std::max(p.second.node_set().estimate(), g_max);
-    if ((end - start) > lt_max) {
-      lt_max = std::max(end - start, lt_max);
-      start_max = start;
-      end_max = end;
-    }
-
-    out_comps_file << p.second.edge_set().estimate() << " "
-      << p.second.node_set().estimate() << " " << start << " " << end << "\n";
+  if (opts.in_components) {
+    std::ofstream in_comps_file;
+    if (opts.in_comps_file())
+      in_comps_file.open(opts.in_comps_filename);
+    else
+      in_comps_file.basic_ios<char>::rdbuf(&null_buf); // nope nope nope
+
+    if (opts.ensemble)
+      log_in_component_sizes<temp_edge,
+        hll_ensemble_estimator, hll_ensemble_estimator_readonly>(
+          eg, opts.hll_seed, summary_file, in_comps_file);
+    else
+      log_in_component_sizes<temp_edge,
+        hll_estimator, hll_estimator_readonly>(
+          eg, opts.hll_seed, summary_file, in_comps_file);
   }
 
-  summary_file << "largest-out-e: " << e_max << std::endl;
-  summary_file << "largest-out-g: " << g_max << std::endl;
-  summary_file << "largest-out-lt: " << lt_max << std::endl;
-
-  summary_file << "loc-lt-begin: " << start_max << std::endl;
-  summary_file << "loc-lt-end: "   << end_max << std::endl;
+  if (opts.ensemble) {
+    summary_file << "ensemble-size: "
+      << hll_ensemble_estimator<temp_edge>::ensemble_size << std::endl;
+    if (opts.dt_list.empty())
+      log_out_component_sizes<temp_edge,
+        hll_ensemble_estimator, hll_ensemble_estimator_readonly>(
+          eg, opts.hll_seed, summary_file, out_comps_file);
+    else
+      log_out_component_sizes_dt_list<temp_edge,
+        hll_ensemble_estimator, hll_ensemble_estimator_readonly>(
+          eg, opts.dt_list, opts.hll_seed, opts.threads,
+          summary_file, out_comps_file);
+  } else {
+    if (opts.dt_list.empty())
+      log_out_component_sizes<temp_edge,
+        hll_estimator, hll_estimator_readonly>(
+          eg, opts.hll_seed, summary_file, out_comps_file);
+    else
+      log_out_component_sizes_dt_list<temp_edge,
+        hll_estimator, hll_estimator_readonly>(
+          eg, opts.dt_list, opts.hll_seed, opts.threads,
+          summary_file, out_comps_file);
+  }
 }
-
@@ -35,6 +35,45 @@ cxxopts::Options define_options() {
      cxxopts::value<double>()->default_value("0.001"))
     ("exponential",
      "exponentially decay probably of a link in event graph w.r.t. time")
+    ("ensemble",
+     "carry an ensemble of independently seeded HyperLogLog sketches per "
+     "event and rank candidates by the median estimate")
+    ("threads",
+     "number of threads used to verify candidates (0 means all available)",
+     cxxopts::value<size_t>()->default_value("0"))
+    ("parallel-bfs-threshold",
+     "search exact out-components estimated to have more than this many "
+     "events with a parallel breadth-first search on --threads threads (0 "
+     "disables)",
+     cxxopts::value<size_t>()->default_value("1000000"))
+    ("two-tier",
+     "re-estimate the ambiguous largest candidates with a second, higher "
+     "precision sweep over the events reachable from them before verifying "
+     "them exactly")
+    ("pipeline",
+     "verify candidates while the estimation sweep is still running "
+     "(cannot be combined with --two-tier)")
+    ("top-k",
+     "also find the k largest out-components by size-measure, each correct "
+     "with the given significance (0 disables)",
+     cxxopts::value<size_t>()->default_value("0"))
+    ("vertex-states",
+     "estimate out-components keeping sketches per vertex instead of per "
+     "pending event, which bounds memory use on dense bursts of events "
+     "(deterministic prob-dist only)")
+    ("contract-chains",
+     "run the estimation sweep over maximal chains of events with a single "
+     "successor that has a single predecessor, keeping one sketch per chain "
+     "(cannot be combined with --vertex-states)")
+    ("transitive-reduction",
+     "leave out event graph links of directed and delayed networks that are "
+     "implied by other links (deterministic prob-dist only)")
+    ("dt-list",
+     "comma separated list of dt values. Runs the estimation and the largest "
+     "out-component search for each of them on one shared event graph, up to "
+     "--threads of them at once, and writes one row per dt to the summary "
+     "(cannot be combined with --two-tier, --pipeline or --top-k)",
+     cxxopts::value<std::string>())
     ("h,help", "Print help")
     ;
 
@@ -52,6 +91,14 @@ cxxopts::Options define_options() {
      cxxopts::value<std::string>())
     ("largest-out-component", "file to store largest out-component events",
      cxxopts::value<std::string>())
+    ("sketch-store",
+     "file to store the final out-component sketches of events, for "
+     "query_sketch_store",
+     cxxopts::value<std::string>())
+    ("sketch-store-events",
+     "events whose sketches are stored: roots (events with no predecessor) "
+     "or all",
+     cxxopts::value<std::string>()->default_value("roots"))
     ;
   return options;
 }
@@ -94,6 +141,12 @@ struct options_t {
     }
     std::string loc_filename;
 
+    bool sketch_store() const {
+      return !sketch_store_filename.empty();
+    }
+    std::string sketch_store_filename;
+    bool sketch_store_all = false;
+
     size_t temporal_reserve = 0;
     std::string network_filename;
 
@@ -105,7 +158,26 @@ struct options_t {
 
     double significance;
 
+    bool ensemble = false;
+
+    size_t threads = 0;
+
+    size_t parallel_bfs_threshold = 0;
+
+    size_t top_k = 0;
+
+    bool two_tier = false;
+
+    bool pipeline = false;
+
+    bool vertex_states = false;
+
+    bool contract_chains = false;
+
+    bool transitive_reduction = false;
+
     temp_time dt;
+    std::vector<temp_time> dt_list;
 };
 
 options_t parse_options(int argc, const char* argv[]) {
@@ -171,8 +243,61 @@ options_t parse_options(int argc, const char* argv[]) {
   if (options.count("summary") != 0)
     opts.summary_filename = options["summary"].as<std::string>();
 
+  if (options.count("sketch-store") != 0)
+    opts.sketch_store_filename = options["sketch-store"].as<std::string>();
+
+  if (options["sketch-store-events"].as<std::string>() == "all") {
+    opts.sketch_store_all = true;
+  } else if (options["sketch-store-events"].as<std::string>() != "roots") {
+    std::cerr << "ERROR: sketch-store-events should be roots or all"
+      << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
+  opts.ensemble = options["ensemble"].as<bool>();
+
+  opts.threads = options["threads"].as<size_t>();
+
+  opts.parallel_bfs_threshold =
+    options["parallel-bfs-threshold"].as<size_t>();
+
+  opts.top_k = options["top-k"].as<size_t>();
+
+  opts.two_tier = options["two-tier"].as<bool>();
+
+  opts.pipeline = options["pipeline"].as<bool>();
+  if (opts.pipeline && opts.two_tier) {
+    std::cerr << "ERROR: --pipeline cannot be combined with --two-tier"
+      << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
   opts.dt = options["dt"].as<temp_time>();
 
+  if (options.count("dt-list") != 0) {
+    opts.dt_list = parse_list<temp_time>(
+        options["dt-list"].as<std::string>());
+    if (opts.dt_list.empty()) {
+      std::cerr << "ERROR: dt-list should be a comma separated list of dt "
+        "values" << std::endl;
+      std::cerr << option_defs.help({"", "Event List File", "Output"})
+        << std::endl;
+      std::exit(1);
+    }
+    if (opts.two_tier || opts.pipeline || opts.top_k > 0 ||
+        opts.sketch_store()) {
+      std::cerr << "ERROR: --dt-list cannot be combined with --two-tier, "
+        "--pipeline, --top-k or --sketch-store" << std::endl;
+      std::cerr << option_defs.help({"", "Event List File", "Output"})
+        << std::endl;
+      std::exit(1);
+    }
+  }
+
   if (options["prob-dist"].as<std::string>() == "deterministic") {
     opts.prob_dist_type = prob_dist_types::deterministic;
     opts.prob_dist = prob_dist<prob_dist_types::deterministic>;
@@ -187,6 +312,35 @@ options_t parse_options(int argc, const char* argv[]) {
     std::exit(1);
   }
 
+  opts.vertex_states = options["vertex-states"].as<bool>();
+  if (opts.vertex_states &&
+      opts.prob_dist_type != prob_dist_types::deterministic) {
+    std::cerr << "ERROR: --vertex-states needs the deterministic prob-dist"
+      << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
+  opts.contract_chains = options["contract-chains"].as<bool>();
+  if (opts.contract_chains && opts.vertex_states) {
+    std::cerr << "ERROR: --contract-chains cannot be combined with "
+      "--vertex-states" << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
+  opts.transitive_reduction = options["transitive-reduction"].as<bool>();
+  if (opts.transitive_reduction &&
+      opts.prob_dist_type != prob_dist_types::deterministic) {
+    std::cerr << "ERROR: --transitive-reduction needs the deterministic "
+      "prob-dist" << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+
   return opts;
 }
 
@@ -1,4 +1,12 @@
 #include <unordered_map>
+#include <optional>
+#include <functional>
+#include <deque>
+#include <atomic>
+#include <type_traits>
+
+#include "radix_heap.hpp"
+#include "parallel.hpp"
 
 namespace hll {
   template <>
@@ -39,62 +47,392 @@ namespace hll {
   }
 }
 
+// called with each root event and its estimate as soon as it is final
+template <class EdgeT, template<typename> class ReadOnlyEstimatorT>
+using root_callback = std::function<void(
+    const EdgeT&, const counter<EdgeT, ReadOnlyEstimatorT>&)>;
+
+// called with every event and its full sketch as soon as it is final, before
+// it is reduced to a read-only estimate. The flag is set for root events.
+template <class EdgeT, template<typename> class EstimatorT>
+using sketch_callback = std::function<void(
+    const EdgeT&, const counter<EdgeT, EstimatorT>&, bool)>;
+
+// direction of a component sweep over topological order: out-components are
+// swept backwards, merging the sketches of successors, and in-components
+// forwards, merging those of predecessors
+enum class sweep_direction { out, in };
+
+// Sweep over `events', which are in topological order and closed under the
+// adjacency followed in `Direction', estimating the component of each event.
+// Events are released once `pending(e)' of the events adjacent to them in the
+// other direction have been processed. Events with no such event are the ends
+// of the sweep, roots for out-components and leaves for in-components, and are
+// the only ones returned if `only_ends' is set.
+template <sweep_direction Direction,
+         class EdgeT,
+         template<typename> class EstimatorT,
+         template<typename> class ReadOnlyEstimatorT,
+         class PendingF>
+std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+sweep_components(
+    const event_graph<EdgeT>& eg,
+    const std::vector<EdgeT>& events,
+    uint32_t seed,
+    bool only_ends,
+    PendingF pending,
+    const root_callback<EdgeT, ReadOnlyEstimatorT>& on_end={},
+    const sketch_callback<EdgeT, EstimatorT>& on_sketch={}) {
+  constexpr bool out = (Direction == sweep_direction::out);
+
+  std::unordered_map<EdgeT, counter<EdgeT, EstimatorT>> components;
+  std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+    component_ests;
+  component_ests.reserve(events.size());
+
+  std::unordered_map<EdgeT, size_t> pending_counts;
+
+  size_t log_increment = events.size()/20;
+
+  for (size_t step = 0; step < events.size(); step++) {
+    if (log_increment > 10'000 && step % log_increment == 0)
+      std::cerr << step*100/events.size() <<
+        (out ? "\% processed" : "\% processed (in-components)") << std::endl;
+
+    const EdgeT& e = out ? events[events.size() - 1 - step] : events[step];
+
+    components.emplace(e, seed);
+    pending_counts[e] = pending(e);
+
+    for (const auto& other: out ? eg.successors(e) : eg.predecessors(e)) {
+
+      components.at(e).merge(components.at(other));
+
+      if (--pending_counts.at(other) == 0) {
+        if (on_sketch)
+          on_sketch(other, components.at(other), false);
+        if (!only_ends)
+          component_ests.emplace_back(other, components.at(other));
+        components.erase(other);
+        pending_counts.erase(other);
+      }
+    }
+
+    components.at(e).insert(e);
+
+    if (pending_counts.at(e) == 0) {
+      if (on_sketch)
+        on_sketch(e, components.at(e), true);
+      component_ests.emplace_back(e, components.at(e));
+      if (on_end)
+        on_end(component_ests.back().first, component_ests.back().second);
+      components.erase(e);
+      pending_counts.erase(e);
+    }
+  }
+
+  if (only_ends)
+    component_ests.shrink_to_fit();
+
+  return component_ests;
+}
+
+
+template <class EdgeT,
+         template<typename> class EstimatorT = hll_estimator,
+         template<typename> class ReadOnlyEstimatorT = hll_estimator_readonly>
+std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+out_component_size_estimate(
+    const event_graph<EdgeT>& eg,
+    uint32_t seed,
+    bool only_roots=false,
+    const root_callback<EdgeT, ReadOnlyEstimatorT>& on_root={},
+    const sketch_callback<EdgeT, EstimatorT>& on_sketch={}) {
+  return sweep_components<sweep_direction::out,
+         EdgeT, EstimatorT, ReadOnlyEstimatorT>(
+      eg, eg.topo(), seed, only_roots,
+      [&eg](const EdgeT& e) { return eg.predecessors(e).size(); },
+      on_root, on_sketch);
+}
+
+// Same as above, restricted to the sub-DAG induced by `events', which have to
+// be in topological order and closed under successors, e.g. the output of
+// reachable_events(). Predecessors outside of `events' are ignored.
 template <class EdgeT,
          template<typename> class EstimatorT = hll_estimator,
          template<typename> class ReadOnlyEstimatorT = hll_estimator_readonly>
 std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
 out_component_size_estimate(
     const event_graph<EdgeT>& eg,
+    const std::vector<EdgeT>& events,
     uint32_t seed,
     bool only_roots=false) {
+  return sweep_components<sweep_direction::out,
+         EdgeT, EstimatorT, ReadOnlyEstimatorT>(
+      eg, events, seed, only_roots,
+      [&eg, &events](const EdgeT& e) {
+        size_t in_degree = 0;
+        for (auto&& p: eg.predecessors(e))
+          if (std::binary_search(events.begin(), events.end(), p))
+            in_degree++;
+        return in_degree;
+      });
+}
+
+// Alternative to out_component_size_estimate() for deterministic adjacency
+// that keeps sketches per vertex instead of per pending event. Each vertex
+// holds the merged out-components of the events leaving it, one per departure
+// time, for as long as an event still to be processed could take effect on it
+// less than dt before that departure. The out-component of an event is then
+// the union of the departures within dt after it takes effect on each of its
+// mutated vertices. With undirected events, a departure also mutates the
+// vertex it leaves and replaces the later departures, so each vertex keeps a
+// single sketch and the live sketches are bounded by the active vertices. With
+// directed events, a vertex keeps one departure per distinct departure time
+// within dt after the latest arrival still to be processed, which for delayed
+// events can be long before the departures.
+template <class EdgeT,
+         template<typename> class EstimatorT = hll_estimator,
+         template<typename> class ReadOnlyEstimatorT = hll_estimator_readonly>
+std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+vertex_state_out_component_size_estimate(
+    const event_graph<EdgeT>& eg,
+    uint32_t seed,
+    bool only_roots=false,
+    const root_callback<EdgeT, ReadOnlyEstimatorT>& on_root={},
+    const sketch_callback<EdgeT, EstimatorT>& on_sketch={}) {
+  using TimeType = typename EdgeT::TimeType;
+  using VertT = typename EdgeT::VertexType;
+
+  // delayed events can take effect long after they happen, so departures are
+  // kept until no event arriving at the vertex is left to be processed.
+  constexpr bool delayed = std::is_same<EdgeT,
+            dag::directed_delayed_temporal_edge<VertT, TimeType>>::value;
+
+  const auto& events = eg.topo();
+  TimeType dt = eg.expected_dt();
+
+  struct departure {
+    TimeType time;
+    counter<EdgeT, EstimatorT> comp;
+  };
+  // sorted by time, earliest first
+  std::unordered_map<VertT, std::deque<departure>> departures;
+  size_t live = 0, live_after_expire = 0;
 
+  // for delayed events, arrival times of each vertex sorted by event time,
+  // paired with the latest effect time of any arrival up to that one
+  std::unordered_map<VertT, std::vector<std::pair<TimeType, TimeType>>>
+    latest_arrival;
+  if constexpr (delayed)
+    for (auto&& [v, in_events]: eg.in_incidence()) {
+      auto& arrivals = latest_arrival[v];
+      for (auto&& e: in_events)
+        arrivals.emplace_back(e.time, e.effect_time());
+      std::sort(arrivals.begin(), arrivals.end());
+      for (size_t i = 1; i < arrivals.size(); i++)
+        arrivals[i].second = std::max(arrivals[i].second,
+            arrivals[i-1].second);
+    }
+
+  // drops departures from v that no event before `time' can reach
+  auto expire = [&](const VertT& v, std::deque<departure>& deps,
+      TimeType time) {
+    TimeType latest = time;
+    if constexpr (delayed) {
+      bool reachable = false;
+      auto arrivals = latest_arrival.find(v);
+      if (arrivals != latest_arrival.end()) {
+        auto next = std::lower_bound(
+            arrivals->second.begin(), arrivals->second.end(),
+            std::make_pair(time, std::numeric_limits<TimeType>::lowest()));
+        if (next != arrivals->second.begin()) {
+          latest = (next - 1)->second;
+          reachable = true;
+        }
+      }
+      if (!reachable) {
+        live -= deps.size();
+        deps.clear();
+        return;
+      }
+    }
+    while (!deps.empty() && deps.back().time > latest &&
+        !(deps.back().time - latest < dt)) {
+      deps.pop_back();
+      live--;
+    }
+  };
 
-  std::unordered_map<EdgeT, counter<EdgeT, EstimatorT>> out_components;
   std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
     out_component_ests;
-  out_component_ests.reserve(eg.topo().size());
+  out_component_ests.reserve(only_roots ? 0 : events.size());
 
-  std::unordered_map<EdgeT, size_t> in_degrees;
+  std::vector<counter<EdgeT, EstimatorT>> comps;
+  size_t log_increment = events.size()/20;
 
-  size_t log_increment = eg.topo().size()/20;
+  auto group_end = events.end();
+  while (group_end > events.begin()) {
+    TimeType time = (group_end - 1)->time;
+    auto group_begin = std::partition_point(events.begin(), group_end,
+        [time](const EdgeT& e) { return e.time < time; });
 
-  auto temp_edge_iter = eg.topo().rbegin();
-  while (temp_edge_iter < eg.topo().rend()) {
     if (log_increment > 10'000 &&
-        std::distance(eg.topo().rbegin(), temp_edge_iter) % log_increment == 0)
-      std::cerr <<
-        std::distance(
-            eg.topo().rbegin(),
-            temp_edge_iter)*100/eg.topo().size() <<
-        "\% processed" << std::endl;
+        (size_t)(events.end() - group_begin)/log_increment !=
+        (size_t)(events.end() - group_end)/log_increment)
+      std::cerr << (size_t)(events.end() - group_begin)*100/events.size() <<
+        "\% processed (vertex states)" << std::endl;
+
+    // events with the same timestamp cannot reach each other, so all of them
+    // are estimated before any of them departs
+    comps.clear();
+    for (auto it = group_begin; it < group_end; it++) {
+      comps.emplace_back(seed);
+      for (auto&& v: it->mutated_verts()) {
+        auto deps = departures.find(v);
+        if (deps == departures.end())
+          continue;
+        auto first = std::partition_point(
+            deps->second.begin(), deps->second.end(),
+            [it](const departure& d) { return !(d.time > it->effect_time()); });
+        for (; first != deps->second.end() &&
+            first->time - it->effect_time() < dt; first++)
+          comps.back().merge(first->comp);
+      }
+      comps.back().insert(*it);
+    }
+
+    for (auto it = group_begin; it < group_end; it++) {
+      auto& comp = comps[(size_t)(it - group_begin)];
+      auto mutated = it->mutated_verts();
+      for (auto&& v: it->mutator_verts()) {
+        auto& deps = departures[v];
+        // an event that both leaves and mutates v reaches every later
+        // departure from v that is still live
+        if (std::find(mutated.begin(), mutated.end(), v) != mutated.end())
+          while (!deps.empty() && deps.back().time > time) {
+            deps.pop_back();
+            live--;
+          }
+        expire(v, deps, time);
 
-    out_components.emplace(*temp_edge_iter, seed);
-    in_degrees[*temp_edge_iter] =
-      eg.predecessors(*temp_edge_iter).size();
+        if (!deps.empty() && deps.front().time == time)
+          deps.front().comp.merge(comp);
+        else {
+          deps.push_front(departure{time, comp});
+          live++;
+        }
+      }
 
-    for (const auto& other:
-        eg.successors(*temp_edge_iter)) {
+      bool root = eg.predecessors(*it).empty();
+      if (on_sketch)
+        on_sketch(*it, comp, root);
+      if (root || !only_roots) {
+        out_component_ests.emplace_back(*it, comp);
+        if (root && on_root)
+          on_root(out_component_ests.back().first,
+              out_component_ests.back().second);
+      }
+    }
+
+    if (live > 2*live_after_expire + 1024) {
+      for (auto it = departures.begin(); it != departures.end();) {
+        expire(it->first, it->second, time);
+        if (it->second.empty())
+          it = departures.erase(it);
+        else
+          it++;
+      }
+      live_after_expire = live;
+    }
 
-      out_components.at(*temp_edge_iter).merge(out_components.at(other));
+    group_end = group_begin;
+  }
+
+  if (only_roots)
+    out_component_ests.shrink_to_fit();
+
+  return out_component_ests;
+}
+
+
+
+// Same estimates as out_component_size_estimate(), sweeping the chains found
+// by find_event_chains() instead of single events. A chain is walked from its
+// last event to its first with one running sketch, so only the first event of
+// each chain is kept until all of its predecessors have been processed.
+template <class EdgeT,
+         template<typename> class EstimatorT = hll_estimator,
+         template<typename> class ReadOnlyEstimatorT = hll_estimator_readonly>
+std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+contracted_out_component_size_estimate(
+    const event_graph<EdgeT>& eg,
+    const event_chains& chains,
+    uint32_t seed,
+    bool only_roots=false,
+    const root_callback<EdgeT, ReadOnlyEstimatorT>& on_root={},
+    const sketch_callback<EdgeT, EstimatorT>& on_sketch={}) {
+  const auto& events = eg.topo();
+
+  // keyed by the index of the first event of each chain
+  std::unordered_map<size_t, counter<EdgeT, EstimatorT>> out_components;
+  std::unordered_map<size_t, size_t> in_degrees;
+  std::vector<std::pair<EdgeT, counter<EdgeT, ReadOnlyEstimatorT>>>
+    out_component_ests;
+  out_component_ests.reserve(only_roots ? 0 : events.size());
+
+  size_t log_increment = events.size()/20;
+
+  std::vector<size_t> chain;
+  for (size_t head = events.size(); head-- > 0;) {
+    if (log_increment > 10'000 &&
+        (events.size() - head) % log_increment == 0)
+      std::cerr << (events.size() - head)*100/events.size() <<
+        "\% processed (chains)" << std::endl;
 
-      if (--in_degrees.at(other) == 0) {
+    if (!chains.head[head])
+      continue;
+
+    chain.clear();
+    for (size_t i = head; i != event_chains::npos; i = chains.next[i])
+      chain.push_back(i);
+
+    counter<EdgeT, EstimatorT> out_component(seed);
+    for (const auto& other: eg.successors(events[chain.back()])) {
+      size_t other_idx = eg.event_index(other);
+      out_component.merge(out_components.at(other_idx));
+
+      if (--in_degrees.at(other_idx) == 0) {
         if (!only_roots)
           out_component_ests.emplace_back(other,
-              out_components.at(other));
-        out_components.erase(other);
-        in_degrees.erase(other);
+              out_components.at(other_idx));
+        out_components.erase(other_idx);
+        in_degrees.erase(other_idx);
       }
     }
 
-    out_components.at(*temp_edge_iter).insert(*temp_edge_iter);
+    // every event after the head has the previous one as its only
+    // predecessor, so none of them is a root
+    for (size_t k = chain.size() - 1; k > 0; k--) {
+      out_component.insert(events[chain[k]]);
+      if (on_sketch)
+        on_sketch(events[chain[k]], out_component, false);
+      if (!only_roots)
+        out_component_ests.emplace_back(events[chain[k]], out_component);
+    }
+    out_component.insert(events[head]);
+    if (on_sketch)
+      on_sketch(events[head], out_component, chains.in_degree[head] == 0);
 
-    if (in_degrees.at(*temp_edge_iter) == 0) {
-      out_component_ests.emplace_back(*temp_edge_iter,
-        out_components.at(*temp_edge_iter));
-      out_components.erase(*temp_edge_iter);
-      in_degrees.erase(*temp_edge_iter);
+    if (chains.in_degree[head] == 0) {
+      out_component_ests.emplace_back(events[head], out_component);
+      if (on_root)
+        on_root(out_component_ests.back().first,
+            out_component_ests.back().second);
+    } else {
+      in_degrees[head] = chains.in_degree[head];
+      out_components.emplace(head, std::move(out_component));
     }
-    temp_edge_iter++;
   }
 
   if (only_roots)
@@ -104,13 +442,272 @@ out_component_size_estimate(
 }
 
 
+// Reusable scratch space for exact out-component searches. Visited events
+// and last infection times of vertices are kept in dense arrays indexed by
+// event_index() and vertex_index() and stamped with an epoch number, so that
+// clearing them between searches is O(1). A workspace can be reused for any
+// number of searches, but not by two searches at the same time.
+template <class EdgeT>
+class out_component_workspace {
+  public:
+  using TimeType = typename EdgeT::TimeType;
+
+  // prepares the workspace for a new search on `eg'
+  void reset(const event_graph<EdgeT>& eg) {
+    if (_visited_epoch.size() < eg.event_count())
+      _visited_epoch.resize(eg.event_count(), 0);
+    if (_infected_epoch.size() < eg.vertex_count()) {
+      _infected_epoch.resize(eg.vertex_count(), 0);
+      _active_epoch.resize(eg.vertex_count(), 0);
+      _last_infected.resize(eg.vertex_count());
+    }
+
+    if (++_epoch == 0) {
+      std::fill(_visited_epoch.begin(), _visited_epoch.end(), 0);
+      std::fill(_infected_epoch.begin(), _infected_epoch.end(), 0);
+      std::fill(_active_epoch.begin(), _active_epoch.end(), 0);
+      std::fill(_leaving_epoch.begin(), _leaving_epoch.end(), 0);
+      _epoch = 1;
+    }
+
+    _queue.clear();
+    _batch.clear();
+    _frontier.clear();
+    _transit.clear();
+  }
+
+  bool visited(size_t event_idx) const {
+    return _visited_epoch[event_idx] == _epoch;
+  }
+
+  // marks the event as visited. Returns false if it was already visited.
+  bool visit(size_t event_idx) {
+    if (visited(event_idx))
+      return false;
+    _visited_epoch[event_idx] = _epoch;
+    return true;
+  }
+
+  bool infected(size_t vert_idx) const {
+    return _infected_epoch[vert_idx] == _epoch;
+  }
+
+  TimeType last_infected(size_t vert_idx) const {
+    return _last_infected[vert_idx];
+  }
+
+  void infect(size_t vert_idx, TimeType time) {
+    _infected_epoch[vert_idx] = _epoch;
+    _last_infected[vert_idx] = time;
+  }
+
+  // whether the vertex has an entry in frontier()
+  bool active(size_t vert_idx) const {
+    return _active_epoch[vert_idx] == _epoch;
+  }
+
+  void set_active(size_t vert_idx, bool active) {
+    _active_epoch[vert_idx] = active ? _epoch : 0;
+  }
+
+  // next event leaving an infected vertex: `(*out)[pos]'
+  struct departure {
+    TimeType time;
+    size_t vert_idx;
+    const std::vector<EdgeT>* out;
+    size_t pos;
+  };
+
+  // search queue or heap, emptied on reset
+  std::vector<EdgeT>& queue() { return _queue; }
+
+  // events decided together, emptied on reset
+  std::vector<EdgeT>& batch() { return _batch; }
+
+  // heap of departures of the sparse search, emptied on reset
+  std::vector<departure>& frontier() { return _frontier; }
+
+  // topo() indices of delayed events in transition by effect time, emptied
+  // on reset
+  monotone_heap<TimeType, size_t>& transit() { return _transit; }
+
+  // times at which events found by an in-component search leave the vertex,
+  // emptied on reset. Only in-component searches use these, so they are
+  // allocated on first use.
+  std::vector<TimeType>& leaving(size_t vert_idx) {
+    if (_leaving_epoch.size() <= vert_idx) {
+      _leaving_epoch.resize(vert_idx + 1, 0);
+      _leaving.resize(vert_idx + 1);
+    }
+    if (_leaving_epoch[vert_idx] != _epoch) {
+      _leaving_epoch[vert_idx] = _epoch;
+      _leaving[vert_idx].clear();
+    }
+    return _leaving[vert_idx];
+  }
+
+  private:
+  uint32_t _epoch = 0;
+  std::vector<uint32_t> _visited_epoch, _infected_epoch, _active_epoch;
+  std::vector<uint32_t> _leaving_epoch;
+  std::vector<TimeType> _last_infected;
+  std::vector<std::vector<TimeType>> _leaving;
+  std::vector<EdgeT> _queue, _batch;
+  std::vector<departure> _frontier;
+  monotone_heap<TimeType, size_t> _transit;
+};
+
+// workspace used by out-component searches that are not given one explicitly
+template <class EdgeT>
+out_component_workspace<EdgeT>& thread_workspace() {
+  thread_local out_component_workspace<EdgeT> ws;
+  return ws;
+}
+
+
+// Sets up the dense event and vertex indices of `eg` for bitmap_estimator.
+// `eg` has to outlive every bitmap_estimator constructed afterwards.
+template <class EdgeT>
+void use_dense_indices(const event_graph<EdgeT>& eg) {
+  using VertexType = typename EdgeT::VertexType;
+  bitmap_estimator<EdgeT>::set_universe(eg.event_count(),
+      [&eg](const EdgeT& e) { return eg.event_index(e); });
+  bitmap_estimator<VertexType>::set_universe(eg.vertex_count(),
+      [&eg](const VertexType& v) { return eg.vertex_index(v); });
+}
 
+// Frees the bitmaps bitmap_estimator keeps for reuse on the calling thread,
+// once the searches are over. Those of parallel_for workers go with their
+// threads.
 template <class EdgeT>
-counter<EdgeT, exact_estimator> out_component(
+void release_bitmap_pools() {
+  bitmap_estimator<EdgeT>::release_pool();
+  bitmap_estimator<typename EdgeT::VertexType>::release_pool();
+}
+
+// Events reachable from any of `roots', roots included, in topological order.
+template <class EdgeT>
+std::vector<EdgeT> reachable_events(
+    const event_graph<EdgeT>& eg,
+    const std::vector<EdgeT>& roots,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+  ws.reset(eg);
+  std::vector<EdgeT>& search = ws.queue();
+  for (auto&& r: roots)
+    if (ws.visit(eg.event_index(r)))
+      search.push_back(r);
+
+  for (size_t head = 0; head < search.size(); head++) {
+    EdgeT e = search[head];
+    for (auto&& s: eg.successors(e))
+      if (ws.visit(eg.event_index(s)))
+        search.push_back(s);
+  }
+
+  std::vector<EdgeT> events(search.begin(), search.end());
+  std::sort(events.begin(), events.end());
+  return events;
+}
+
+// search kernels, declared up front so that the dispatchers below can pass the
+// exact estimator type explicitly
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> generic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>> bounded_generic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit=false,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>>
+bounded_deterministic_out_component(
     const event_graph<EdgeT>& eg,
     const EdgeT& root,
     size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit=false,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> sparse_deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>>
+bounded_sparse_deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit=false,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>());
+
+// Chooses between the deterministic kernels. The scan visits every event in
+// the time span of the out-component, at least those leaving within dt of
+// the root taking effect, while the sparse kernel does a few heap operations
+// per event leaving an infected vertex, on the order of the out-component
+// size. Without an estimate (`edge_size_est' of zero) the scan is used.
+template <class EdgeT>
+bool prefer_sparse_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
     size_t edge_size_est) {
+  constexpr size_t sparse_cost_factor = 8;
+  if (edge_size_est == 0)
+    return false;
+
+  const auto& topo = eg.topo();
+  auto first = std::upper_bound(topo.begin(), topo.end(), root);
+  auto last = std::partition_point(first, topo.end(),
+      [&root, &eg](const EdgeT& e) {
+        return e.time <= root.effect_time() ||
+          e.time - root.effect_time() < eg.expected_dt();
+      });
+  return edge_size_est*sparse_cost_factor < (size_t)(last - first);
+}
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
 
   using TimeT = typename EdgeT::TimeType;
   using VertT = typename EdgeT::VertexType;
@@ -119,88 +716,367 @@ counter<EdgeT, exact_estimator> out_component(
   using undirected = dag::undirected_temporal_edge<VertT, TimeT>;
 
   if (!eg.deterministic())
-    return generic_out_component(
-        eg, root, node_size_est, edge_size_est);
+    return generic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
   else if constexpr (std::is_same<EdgeT, directed>::value ||
             std::is_same<EdgeT, undirected>::value ||
-            std::is_same<EdgeT, delayed>::value)
-    return deterministic_out_component(
-        eg, root, node_size_est, edge_size_est);
+            std::is_same<EdgeT, delayed>::value) {
+    if (prefer_sparse_out_component(eg, root, edge_size_est))
+      return sparse_deterministic_out_component<ExactEstimatorT>(
+          eg, root, node_size_est, edge_size_est, ws);
+    return deterministic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
+  }
   else
-    return generic_out_component(
-        eg, root, node_size_est, edge_size_est);
+    return generic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est, ws);
 }
 
-template <class EdgeT>
-counter<EdgeT, exact_estimator> generic_out_component(
+template <template<typename> class ExactEstimatorT,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> generic_out_component(
     const event_graph<EdgeT>& eg,
     const EdgeT& root,
     size_t node_size_est,
-    size_t edge_size_est) {
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws) {
 
-  std::queue<EdgeT> search({root});
-  counter<EdgeT, exact_estimator> out_component(0, edge_size_est, node_size_est);
-  out_component.insert(root);
+  ws.reset(eg);
+  std::vector<EdgeT>& search = ws.queue();
+  search.push_back(root);
+  size_t root_idx = eg.event_index(root);
+  ws.visit(root_idx);
 
-  while (!search.empty()) {
-    EdgeT e = search.front();
-    search.pop();
-    for (auto&& s: eg.successors(e))
-      if (!out_component.edge_set().contains(s)) {
-        search.push(s);
-        out_component.insert(s);
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  counter<EdgeT, ExactEstimatorT> out_component(0, edge_size_est, node_size_est);
+  out_component.insert(root, root_idx, vertex_index);
+
+  for (size_t head = 0; head < search.size(); head++) {
+    EdgeT e = search[head];
+    for (auto&& s: eg.successors(e)) {
+      size_t s_idx = eg.event_index(s);
+      if (ws.visit(s_idx)) {
+        search.push_back(s);
+        out_component.insert(s, s_idx, vertex_index);
       }
+    }
   }
 
   return out_component;
 }
 
+// Exact out-component of `root' by a level-synchronous breadth-first search
+// on `threads' threads (0 means all available), for out-components too large
+// for one core. Events are claimed in a shared atomic bitmap. Each level is
+// handed out to the threads in chunks as they become free, and every thread
+// collects the events it discovers in its own buffer and counter, which are
+// joined after the level. Small levels are expanded on the calling thread.
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> parallel_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    size_t threads) {
+  constexpr size_t min_parallel_level = 4096;
+  constexpr size_t chunk = 256;
+  size_t workers = worker_count(threads);
+
+  std::vector<std::atomic<uint64_t>> visited((eg.event_count() + 63)/64);
+  auto visit = [&visited](size_t event_idx) {
+    uint64_t bit = uint64_t(1) << (event_idx % 64);
+    return (visited[event_idx/64].fetch_or(bit,
+          std::memory_order_relaxed) & bit) == 0;
+  };
+
+  std::vector<counter<EdgeT, ExactEstimatorT>> comps;
+  comps.reserve(workers);
+  comps.emplace_back(0, edge_size_est, node_size_est);
+  for (size_t t = 1; t < workers; t++)
+    comps.emplace_back(0, edge_size_est/workers, node_size_est);
 
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  std::vector<std::vector<EdgeT>> next(workers);
+  std::vector<EdgeT> level = {root};
+  size_t root_idx = eg.event_index(root);
+  visit(root_idx);
+  comps[0].insert(root, root_idx, vertex_index);
 
-template <class EdgeT>
-counter<EdgeT, exact_estimator> deterministic_out_component(
+  auto expand = [&](size_t i, size_t thread_idx) {
+    for (auto&& s: eg.successors(level[i])) {
+      size_t s_idx = eg.event_index(s);
+      if (visit(s_idx)) {
+        next[thread_idx].push_back(s);
+        comps[thread_idx].insert(s, s_idx, vertex_index);
+      }
+    }
+  };
+
+  while (!level.empty()) {
+    if (workers == 1 || level.size() < min_parallel_level)
+      for (size_t i = 0; i < level.size(); i++)
+        expand(i, 0);
+    else
+      parallel_for(level.size(), workers, expand, chunk);
+
+    level.clear();
+    for (auto&& n: next) {
+      level.insert(level.end(), n.begin(), n.end());
+      n.clear();
+    }
+  }
+
+  for (size_t t = 1; t < workers; t++)
+    comps[0].merge(comps[t]);
+  return std::move(comps[0]);
+}
+
+
+
+template <template<typename> class ExactEstimatorT,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> deterministic_out_component(
     const event_graph<EdgeT>& eg,
     const EdgeT& root,
     size_t node_size_est,
-    size_t edge_size_est) {
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws) {
+  // with zero limits the search is never abandoned
+  return *bounded_deterministic_out_component<ExactEstimatorT>(eg, root,
+      node_size_est, edge_size_est, 0ul, 0ul, false, ws);
+}
+
+template <template<typename> class ExactEstimatorT,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> sparse_deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws) {
+  return *bounded_sparse_deterministic_out_component<ExactEstimatorT>(eg,
+      root, node_size_est, edge_size_est, 0ul, 0ul, false, ws);
+}
+
+
+
+// Upper bound on the size of an out-component that currently has `edges'
+// events and `nodes' nodes and can grow by at most `remaining' events, each
+// adding at most `verts_per_event' nodes. Returns true if the out-component
+// cannot reach either limit.
+template <class EdgeT, class LimitT>
+bool out_component_unreachable(
+    const event_graph<EdgeT>& eg,
+    size_t edges, size_t nodes,
+    size_t remaining, size_t verts_per_event,
+    const LimitT& edge_limit, const LimitT& node_limit) {
+  size_t max_edges = edges + remaining;
+  size_t max_nodes = std::min(eg.node_count(),
+      nodes + remaining*verts_per_event);
+  return max_edges < static_cast<size_t>(edge_limit) &&
+    max_nodes < static_cast<size_t>(node_limit);
+}
+
+template <class EdgeT, template<typename> class ExactEstimatorT, class LimitT>
+bool out_component_reached(
+    const counter<EdgeT, ExactEstimatorT>& out_component,
+    const LimitT& edge_limit, const LimitT& node_limit) {
+  return out_component.edge_set().size() >= static_cast<size_t>(edge_limit) ||
+    out_component.node_set().size() >= static_cast<size_t>(node_limit);
+}
+
+// Same as out_component(), but gives up and returns an empty optional as soon
+// as it is certain that the out-component has fewer than `edge_limit' events
+// and fewer than `node_limit' nodes. If `stop_at_limit' is set, the search
+// also stops as soon as either limit is reached, in which case the returned
+// counter only holds part of the out-component. Limits can be std::atomic
+// values so that concurrent searches can share a growing threshold.
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>> bounded_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit=false,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+
+  using TimeT = typename EdgeT::TimeType;
+  using VertT = typename EdgeT::VertexType;
+  using delayed = dag::directed_delayed_temporal_edge<VertT, TimeT>;
+  using directed = dag::directed_temporal_edge<VertT, TimeT>;
+  using undirected = dag::undirected_temporal_edge<VertT, TimeT>;
+
+  if (!eg.deterministic())
+    return bounded_generic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est,
+        edge_limit, node_limit, stop_at_limit, ws);
+  else if constexpr (std::is_same<EdgeT, directed>::value ||
+            std::is_same<EdgeT, undirected>::value ||
+            std::is_same<EdgeT, delayed>::value) {
+    if (prefer_sparse_out_component(eg, root, edge_size_est))
+      return bounded_sparse_deterministic_out_component<ExactEstimatorT>(
+          eg, root, node_size_est, edge_size_est,
+          edge_limit, node_limit, stop_at_limit, ws);
+    return bounded_deterministic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est,
+        edge_limit, node_limit, stop_at_limit, ws);
+  }
+  else
+    return bounded_generic_out_component<ExactEstimatorT>(
+        eg, root, node_size_est, edge_size_est,
+        edge_limit, node_limit, stop_at_limit, ws);
+}
 
+template <template<typename> class ExactEstimatorT,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>> bounded_generic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit,
+    out_component_workspace<EdgeT>& ws) {
+
+  // events are visited in topological order, so that everything that is yet
+  // to be discovered comes after the top of the heap.
   auto comp_function = [](const EdgeT& e1, const EdgeT& e2) {
-    return (e1.effect_time()) > (e2.effect_time());
+    return e2 < e1;
   };
 
-  std::priority_queue<
-    EdgeT, std::vector<EdgeT>,
-    decltype(comp_function)> in_transition(comp_function);
+  ws.reset(eg);
+  std::vector<EdgeT>& search = ws.queue();
+  search.push_back(root);
+  size_t root_idx = eg.event_index(root);
+  ws.visit(root_idx);
 
-  in_transition.push(root);
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  counter<EdgeT, ExactEstimatorT> out_component(0, edge_size_est, node_size_est);
+  out_component.insert(root, root_idx, vertex_index);
+
+  size_t verts_per_event = root.mutated_verts().size();
+  constexpr size_t check_interval = 64;
+  size_t visited = 0;
+
+  while (!search.empty()) {
+    if (stop_at_limit &&
+        out_component_reached(out_component, edge_limit, node_limit))
+      return out_component;
+
+    if (visited++ % check_interval == 0) {
+      size_t remaining = (size_t)(eg.topo().end() - std::upper_bound(
+            eg.topo().begin(), eg.topo().end(), search.front()));
+      if (out_component_unreachable(eg,
+            out_component.edge_set().size(), out_component.node_set().size(),
+            remaining, verts_per_event, edge_limit, node_limit))
+        return std::nullopt;
+    }
+
+    std::pop_heap(search.begin(), search.end(), comp_function);
+    EdgeT e = search.back();
+    search.pop_back();
+    for (auto&& s: eg.successors(e)) {
+      size_t s_idx = eg.event_index(s);
+      if (ws.visit(s_idx)) {
+        search.push_back(s);
+        std::push_heap(search.begin(), search.end(), comp_function);
+        out_component.insert(s, s_idx, vertex_index);
+      }
+    }
+  }
+
+  if (out_component_unreachable(eg,
+        out_component.edge_set().size(), out_component.node_set().size(),
+        0, verts_per_event, edge_limit, node_limit))
+    return std::nullopt;
+
+  return out_component;
+}
+
+template <template<typename> class ExactEstimatorT,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>>
+bounded_deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit,
+    out_component_workspace<EdgeT>& ws) {
+
+  ws.reset(eg);
+
+  // infecting events that are still in transition. Effect times are pushed
+  // in nondecreasing order of the popped ones, which lets integer times use
+  // a radix heap.
+  auto& in_transition = ws.transit();
+  size_t root_idx = eg.event_index(root);
+  in_transition.push(root.effect_time(), root_idx);
 
-  using VertexType = typename EdgeT::VertexType;
   using TimeType = typename EdgeT::TimeType;
 
-  counter<EdgeT, exact_estimator, exact_estimator>
-    out_component(0, edge_size_est, node_size_est);
-  out_component.insert(root);
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
 
-  std::unordered_map<VertexType, TimeType> last_infected;
-  last_infected.reserve(eg.topo().size());
+  // inserts the event at `e_idx' and infects its mutated vertices from its
+  // effect time, looking up each vertex once for both
+  auto insert_infecting = [&](const EdgeT& e, size_t e_idx,
+      counter<EdgeT, ExactEstimatorT>& comp) {
+    comp.insert(e, e_idx, [&](const auto& v) {
+          size_t v_idx = eg.vertex_index(v);
+          ws.infect(v_idx, e.effect_time());
+          return v_idx;
+        });
+  };
 
-  for (auto && v: root.mutated_verts())
-    last_infected[v] = root.effect_time();
+  counter<EdgeT, ExactEstimatorT>
+    out_component(0, edge_size_est, node_size_est);
+  insert_infecting(root, root_idx, out_component);
 
   TimeType last_infect_time = root.effect_time();
 
+  size_t verts_per_event = root.mutated_verts().size();
+
   auto topo_it = std::upper_bound(eg.topo().begin(), eg.topo().end(), root);
 
+  // infecting events without delay, which only take effect once the scan has
+  // passed every event with the same timestamp
+  std::vector<EdgeT>& same_time = ws.batch();
+
   while (topo_it < eg.topo().end() &&
       (topo_it->time < last_infect_time ||
        topo_it->time - last_infect_time < eg.expected_dt())) {
+    if (!same_time.empty() && same_time.front().time != topo_it->time) {
+      for (auto&& e: same_time)
+        for (auto && v: e.mutated_verts())
+          ws.infect(eg.vertex_index(v), e.time);
+      same_time.clear();
+    }
+
+    // delayed events join the out-component only once they take effect, so
+    // the scanned ones still in transition are counted in the remaining
+    // events instead.
+    size_t remaining =
+      (size_t)(eg.topo().end() - topo_it) + in_transition.size();
+    if (out_component_unreachable(eg,
+          out_component.edge_set().size(), out_component.node_set().size(),
+          remaining, verts_per_event, edge_limit, node_limit))
+      return std::nullopt;
+
+    if (stop_at_limit &&
+        out_component_reached(out_component, edge_limit, node_limit))
+      return out_component;
 
     while (!in_transition.empty() &&
-        in_transition.top().effect_time() < topo_it->time) {
-      for (auto && v: in_transition.top().mutated_verts()) {
-        last_infected[v] = in_transition.top().effect_time();
-      }
-      out_component.insert(in_transition.top());
+        in_transition.top().first < topo_it->time) {
+      size_t e_idx = in_transition.top().second;
+      insert_infecting(eg.topo()[e_idx], e_idx, out_component);
       in_transition.pop();
     }
 
@@ -208,19 +1084,19 @@ counter<EdgeT, exact_estimator> deterministic_out_component(
     bool is_infecting = false;
 
     for (auto && v: topo_it->mutator_verts()) {
-      auto last_infected_it = last_infected.find(v);
-      if (last_infected_it != last_infected.end() &&
-          topo_it->time > last_infected_it->second &&
-          topo_it->time - last_infected_it->second < eg.expected_dt())
+      size_t v_idx = eg.vertex_index(v);
+      if (ws.infected(v_idx) &&
+          topo_it->time > ws.last_infected(v_idx) &&
+          topo_it->time - ws.last_infected(v_idx) < eg.expected_dt())
         is_infecting = true;
     }
 
     if (is_infecting) {
+      size_t e_idx = (size_t)(topo_it - eg.topo().begin());
       if (topo_it->time == topo_it->effect_time()) {
-        out_component.insert(*topo_it);
-        for (auto && v: topo_it->mutated_verts())
-          last_infected[v] = topo_it->time;
-      } else in_transition.push(*topo_it);
+        out_component.insert(*topo_it, e_idx, vertex_index);
+        same_time.push_back(*topo_it);
+      } else in_transition.push(topo_it->effect_time(), e_idx);
       last_infect_time =
         std::max(topo_it->effect_time(), last_infect_time);
     }
@@ -229,9 +1105,290 @@ counter<EdgeT, exact_estimator> deterministic_out_component(
   }
 
   while (!in_transition.empty()) {
-      out_component.insert(in_transition.top());
+      size_t e_idx = in_transition.top().second;
+      out_component.insert(eg.topo()[e_idx], e_idx, vertex_index);
       in_transition.pop();
   }
 
+  if (out_component_unreachable(eg,
+        out_component.edge_set().size(), out_component.node_set().size(),
+        0, verts_per_event, edge_limit, node_limit))
+    return std::nullopt;
+
   return out_component;
 }
+
+// Same as bounded_deterministic_out_component(), but driven by the events
+// leaving infected vertices instead of a scan over topo(). Each infected
+// vertex keeps at most one entry in a heap, its next departure within dt of
+// its latest infection, so the work grows with the out-component and the
+// events leaving its vertices rather than with every event in its time span.
+// Departures with the same timestamp are decided together before any of them
+// infects a vertex.
+template <template<typename> class ExactEstimatorT,
+         class EdgeT, class LimitT>
+std::optional<counter<EdgeT, ExactEstimatorT>>
+bounded_sparse_deterministic_out_component(
+    const event_graph<EdgeT>& eg,
+    const EdgeT& root,
+    size_t node_size_est,
+    size_t edge_size_est,
+    const LimitT& edge_limit,
+    const LimitT& node_limit,
+    bool stop_at_limit,
+    out_component_workspace<EdgeT>& ws) {
+  using TimeType = typename EdgeT::TimeType;
+  using departure = typename out_component_workspace<EdgeT>::departure;
+
+  auto departure_comp = [](const departure& d1, const departure& d2) {
+    return d1.time > d2.time;
+  };
+
+  ws.reset(eg);
+
+  // infecting events that are still in transition
+  auto& in_transition = ws.transit();
+  std::vector<departure>& frontier = ws.frontier();
+  std::vector<EdgeT>& same_time = ws.batch();
+
+  // queues the departure at `pos' if it leaves within dt of the latest
+  // infection of the vertex
+  auto push_departure = [&](size_t vert_idx,
+      const std::vector<EdgeT>* out, size_t pos) {
+    bool active = pos < out->size() &&
+      (*out)[pos].time - ws.last_infected(vert_idx) < eg.expected_dt();
+    if (active) {
+      frontier.push_back(departure{(*out)[pos].time, vert_idx, out, pos});
+      std::push_heap(frontier.begin(), frontier.end(), departure_comp);
+    }
+    ws.set_active(vert_idx, active);
+  };
+
+  // infections take effect in order of effect time, so an active vertex
+  // already has its earliest eligible departure in the heap
+  auto infect = [&](const EdgeT& e) {
+    for (auto&& v: e.mutated_verts()) {
+      size_t v_idx = eg.vertex_index(v);
+      ws.infect(v_idx, e.effect_time());
+      if (ws.active(v_idx))
+        continue;
+      auto out = eg.out_incidence().find(v);
+      if (out == eg.out_incidence().end())
+        continue;
+      auto after = std::partition_point(out->second.begin(),
+          out->second.end(),
+          [&e](const EdgeT& o) { return o.time <= e.effect_time(); });
+      push_departure(v_idx, &out->second,
+          (size_t)(after - out->second.begin()));
+    }
+  };
+
+  auto take_effect = [&](const EdgeT& e) {
+    if (e.time == e.effect_time())
+      infect(e);
+    else
+      in_transition.push(e.effect_time(), eg.event_index(e));
+  };
+
+  auto vertex_index = [&eg](const auto& v) { return eg.vertex_index(v); };
+  counter<EdgeT, ExactEstimatorT>
+    out_component(0, edge_size_est, node_size_est);
+  size_t root_idx = eg.event_index(root);
+  out_component.insert(root, root_idx, vertex_index);
+  ws.visit(root_idx);
+  take_effect(root);
+
+  size_t verts_per_event = root.mutated_verts().size();
+  constexpr size_t check_interval = 64;
+  size_t steps = 0;
+
+  while (!frontier.empty() || !in_transition.empty()) {
+    if (frontier.empty() || (!in_transition.empty() &&
+          in_transition.top().first < frontier.front().time)) {
+      infect(eg.topo()[in_transition.top().second]);
+      in_transition.pop();
+      continue;
+    }
+
+    TimeType time = frontier.front().time;
+
+    if (stop_at_limit &&
+        out_component_reached(out_component, edge_limit, node_limit))
+      return out_component;
+
+    if (steps++ % check_interval == 0) {
+      // events join the out-component when they depart, so those still in
+      // transition are counted twice, which only loosens the bound
+      size_t remaining = (size_t)(eg.topo().end() - std::partition_point(
+            eg.topo().begin(), eg.topo().end(),
+            [time](const EdgeT& e) { return e.time < time; })) +
+        in_transition.size();
+      if (out_component_unreachable(eg,
+            out_component.edge_set().size(), out_component.node_set().size(),
+            remaining, verts_per_event, edge_limit, node_limit))
+        return std::nullopt;
+    }
+
+    same_time.clear();
+    while (!frontier.empty() && frontier.front().time == time) {
+      std::pop_heap(frontier.begin(), frontier.end(), departure_comp);
+      departure d = frontier.back();
+      frontier.pop_back();
+      const EdgeT& e = (*d.out)[d.pos];
+      size_t e_idx = eg.event_index(e);
+      if (ws.visit(e_idx)) {
+        same_time.push_back(e);
+        out_component.insert(e, e_idx, vertex_index);
+      }
+      push_departure(d.vert_idx, d.out, d.pos + 1);
+    }
+
+    for (auto&& e: same_time)
+      take_effect(e);
+  }
+
+  if (out_component_unreachable(eg,
+        out_component.edge_set().size(), out_component.node_set().size(),
+        0, verts_per_event, edge_limit, node_limit))
+    return std::nullopt;
+
+  return out_component;
+}
+
+
+// Union of the out-components of `roots': every event reachable from at least
+// one of them. Roots that are not events of `eg' are ignored.
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> generic_multi_out_component(
+    const event_graph<EdgeT>& eg,
+    const std::vector<EdgeT>& roots,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+  std::vector<EdgeT> known;
+  for (auto&& r: roots)
+    if (std::binary_search(eg.topo().begin(), eg.topo().end(), r))
+      known.push_back(r);
+
+  counter<EdgeT, ExactEstimatorT> out_component(0, edge_size_est, node_size_est);
+  for (auto&& e: reachable_events(eg, known, ws))
+    out_component.insert(e);
+  return out_component;
+}
+
+// Same as generic_multi_out_component(), in one scan over topo() like
+// deterministic_out_component(). A root infects its vertices when the scan
+// reaches it, the same way as an event reached from an earlier root, and the
+// scan jumps to the next root whenever nothing infected is left within dt.
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> deterministic_multi_out_component(
+    const event_graph<EdgeT>& eg,
+    std::vector<EdgeT> roots,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+  using TimeType = typename EdgeT::TimeType;
+
+  std::sort(roots.begin(), roots.end());
+  roots.erase(std::unique(roots.begin(), roots.end()), roots.end());
+
+  ws.reset(eg);
+  auto& in_transition = ws.transit();
+  std::vector<EdgeT>& same_time = ws.batch();
+
+  counter<EdgeT, ExactEstimatorT>
+    out_component(0, edge_size_est, node_size_est);
+
+  const auto& topo = eg.topo();
+  auto topo_it = topo.begin();
+  auto next_root = roots.begin();
+
+  bool spreading = false;
+  TimeType last_infect_time{};
+
+  while (topo_it < topo.end()) {
+    if (!spreading || !(topo_it->time < last_infect_time ||
+          topo_it->time - last_infect_time < eg.expected_dt())) {
+      if (next_root == roots.end())
+        break;
+      topo_it = std::lower_bound(topo_it, topo.end(), *next_root);
+      if (topo_it == topo.end())
+        break;
+    }
+
+    if (!same_time.empty() && same_time.front().time != topo_it->time) {
+      for (auto&& e: same_time)
+        for (auto && v: e.mutated_verts())
+          ws.infect(eg.vertex_index(v), e.time);
+      same_time.clear();
+    }
+
+    while (!in_transition.empty() &&
+        in_transition.top().first < topo_it->time) {
+      const EdgeT& e = topo[in_transition.top().second];
+      for (auto && v: e.mutated_verts())
+        ws.infect(eg.vertex_index(v), e.effect_time());
+      in_transition.pop();
+    }
+
+    while (next_root != roots.end() && *next_root < *topo_it)
+      next_root++;
+    bool is_infecting = next_root != roots.end() && *next_root == *topo_it;
+
+    for (auto && v: topo_it->mutator_verts()) {
+      size_t v_idx = eg.vertex_index(v);
+      if (ws.infected(v_idx) &&
+          topo_it->time > ws.last_infected(v_idx) &&
+          topo_it->time - ws.last_infected(v_idx) < eg.expected_dt())
+        is_infecting = true;
+    }
+
+    if (is_infecting) {
+      size_t e_idx = (size_t)(topo_it - topo.begin());
+      out_component.insert(*topo_it, e_idx,
+          [&eg](const auto& v) { return eg.vertex_index(v); });
+      if (topo_it->time == topo_it->effect_time())
+        same_time.push_back(*topo_it);
+      else
+        in_transition.push(topo_it->effect_time(), e_idx);
+      last_infect_time = spreading ?
+        std::max(topo_it->effect_time(), last_infect_time) :
+        topo_it->effect_time();
+      spreading = true;
+    }
+
+    topo_it++;
+  }
+
+  return out_component;
+}
+
+template <template<typename> class ExactEstimatorT = exact_estimator,
+         class EdgeT>
+counter<EdgeT, ExactEstimatorT> multi_out_component(
+    const event_graph<EdgeT>& eg,
+    const std::vector<EdgeT>& roots,
+    size_t node_size_est,
+    size_t edge_size_est,
+    out_component_workspace<EdgeT>& ws=thread_workspace<EdgeT>()) {
+
+  using TimeT = typename EdgeT::TimeType;
+  using VertT = typename EdgeT::VertexType;
+  using delayed = dag::directed_delayed_temporal_edge<VertT, TimeT>;
+  using directed = dag::directed_temporal_edge<VertT, TimeT>;
+  using undirected = dag::undirected_temporal_edge<VertT, TimeT>;
+
+  if (!eg.deterministic())
+    return generic_multi_out_component<ExactEstimatorT>(
+        eg, roots, node_size_est, edge_size_est, ws);
+  else if constexpr (std::is_same<EdgeT, directed>::value ||
+            std::is_same<EdgeT, undirected>::value ||
+            std::is_same<EdgeT, delayed>::value)
+    return deterministic_multi_out_component<ExactEstimatorT>(
+        eg, roots, node_size_est, edge_size_est, ws);
+  else
+    return generic_multi_out_component<ExactEstimatorT>(
+        eg, roots, node_size_est, edge_size_est, ws);
+}
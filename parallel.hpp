@@ -0,0 +1,64 @@
+#ifndef PARALLEL_H
+#define PARALLEL_H
+
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <algorithm>
+
+// number of worker threads to use when the user asks for `requested' threads,
+// zero meaning all available hardware threads.
+inline size_t worker_count(size_t requested) {
+  if (requested > 0)
+    return requested;
+  return std::max<size_t>(1, std::thread::hardware_concurrency());
+}
+
+// Calls `f(i, thread_idx)' for every i in [0, n) on a pool of `threads'
+// workers. Work items are handed out in increasing order of i, `chunk' at a
+// time, so items with smaller indices start earlier. `thread_idx' is in
+// [0, threads) and can be used to index per-thread state.
+template <class Function>
+void parallel_for(size_t n, size_t threads, Function f, size_t chunk=1) {
+  threads = std::min(worker_count(threads), std::max<size_t>(n, 1));
+  chunk = std::max<size_t>(chunk, 1);
+
+  if (threads == 1) {
+    for (size_t i = 0; i < n; i++)
+      f(i, 0ul);
+    return;
+  }
+
+  std::atomic<size_t> next(0);
+  auto worker = [&next, &f, n, chunk](size_t thread_idx) {
+    size_t begin;
+    while ((begin = next.fetch_add(chunk)) < n)
+      for (size_t i = begin; i < std::min(begin + chunk, n); i++)
+        f(i, thread_idx);
+  };
+
+  std::vector<std::thread> pool;
+  pool.reserve(threads - 1);
+  for (size_t t = 1; t < threads; t++)
+    pool.emplace_back(worker, t);
+  worker(0);
+
+  for (auto&& t: pool)
+    t.join();
+}
+
+// atomically replaces `target' with `value' if `value' is larger.
+template <class T>
+void atomic_max(std::atomic<T>& target, T value) {
+  T current = target.load();
+  while (current < value && !target.compare_exchange_weak(current, value)) {}
+}
+
+// atomically replaces `target' with `value' if `value' is smaller.
+template <class T>
+void atomic_min(std::atomic<T>& target, T value) {
+  T current = target.load();
+  while (value < current && !target.compare_exchange_weak(current, value)) {}
+}
+
+#endif /* PARALLEL_H */
@@ -0,0 +1,160 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <optional>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+
+#include "cxxopts.hpp"
+
+#pragma GCC diagnostic pop
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+#include "sketch_store.hpp"
+
+cxxopts::Options define_options() {
+  cxxopts::Options options("query_sketch_store",
+      "estimated union out-components of sets of events from a sketch store "
+      "written by largest_out_component --sketch-store");
+
+  options.add_options()
+    ("store", "sketch store file (required)",
+     cxxopts::value<std::string>())
+    ("queries",
+     "file with one event set per line, each a list of events in event-list "
+     "format (default: standard input)",
+     cxxopts::value<std::string>())
+    ("h,help", "Print help")
+    ;
+
+  options.add_options("Output")
+    ("estimates",
+     "file to store the estimates of each event set (default: standard "
+     "output)",
+     cxxopts::value<std::string>())
+    ;
+  return options;
+}
+
+struct options_t {
+  public:
+    std::string store_filename;
+
+    bool queries_file() {
+      return !queries_filename.empty();
+    }
+    std::string queries_filename;
+
+    bool estimates_file() {
+      return !estimates_filename.empty();
+    }
+    std::string estimates_filename;
+};
+
+options_t parse_options(int argc, const char* argv[]) {
+  cxxopts::Options option_defs = define_options();
+  auto options = option_defs.parse(argc, argv);
+  options_t opts;
+
+  if (options.count("help") != 0) {
+    std::cerr << option_defs.help({"", "Output"}) << std::endl;
+    std::exit(0);
+  }
+
+  if (options.count("store") == 0) {
+    std::cerr << "ERROR: needs a store argument" << std::endl;
+    std::cerr << option_defs.help({"", "Output"}) << std::endl;
+    std::exit(1);
+  }
+  opts.store_filename = options["store"].as<std::string>();
+
+  if (options.count("queries") != 0)
+    opts.queries_filename = options["queries"].as<std::string>();
+
+  if (options.count("estimates") != 0)
+    opts.estimates_filename = options["estimates"].as<std::string>();
+
+  return opts;
+}
+
+int main(int argc, const char* argv[]) {
+  options_t opts = parse_options(argc, argv);
+
+  std::optional<sketch_store_reader<temp_edge>> store;
+  try {
+    store.emplace(opts.store_filename);
+  } catch (const std::runtime_error& err) {
+    std::cerr << "ERROR: " << err.what() << std::endl;
+    std::exit(1);
+  }
+
+  std::ifstream queries_file;
+  if (opts.queries_file()) {
+    queries_file.open(opts.queries_filename);
+    if (!queries_file) {
+      std::cerr << "ERROR: cannot open " << opts.queries_filename
+        << std::endl;
+      std::exit(1);
+    }
+  }
+  std::istream& queries = opts.queries_file() ? queries_file : std::cin;
+
+  std::ofstream estimates_file;
+  if (opts.estimates_file())
+    estimates_file.open(opts.estimates_filename);
+  std::ostream& estimates =
+    opts.estimates_file() ? estimates_file : std::cout;
+
+  estimates << "# stored-events: " << store->size() << " precision: "
+    << store->precision() << std::endl;
+  estimates << "# set events found events-est nodes-est lifetime-begin "
+    "lifetime-end query-ms" << std::endl;
+
+  // Event sets, one per line. Empty lines and lines starting with `#' are
+  // skipped. Events that are not in the store are only counted in `found'.
+  std::string line;
+  size_t line_number = 0, set = 0;
+  std::vector<temp_edge> events;
+  while (std::getline(queries, line)) {
+    line_number++;
+    if (line.find_first_not_of(" \t\r") == std::string::npos ||
+        line[line.find_first_not_of(" \t\r")] == '#')
+      continue;
+
+    std::istringstream items(line);
+    events.clear();
+    temp_edge e;
+    while (items >> e)
+      events.push_back(e);
+    if (!items.eof()) {
+      std::cerr << "ERROR: cannot parse line " << line_number << std::endl;
+      std::exit(1);
+    }
+
+    auto query_start = std::chrono::steady_clock::now();
+    auto res = store->query(events);
+    auto query_end = std::chrono::steady_clock::now();
+
+    estimates << set++ << " " << events.size() << " " << res.found << " "
+      << res.events << " " << res.nodes << " " << res.lifetime_begin << " "
+      << res.lifetime_end << " "
+      << std::chrono::duration<double, std::milli>(
+          query_end-query_start).count()
+      << std::endl;
+  }
+}
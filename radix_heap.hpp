@@ -0,0 +1,156 @@
+#ifndef RADIX_HEAP_H
+#define RADIX_HEAP_H
+
+#include <array>
+#include <vector>
+#include <limits>
+#include <utility>
+#include <algorithm>
+#include <type_traits>
+
+// Monotone min-heap of (key, value) pairs for integer keys: a pushed key must
+// not be smaller than the last popped one. Keys are kept in buckets by the
+// highest bit in which they differ from the last popped key, so a push is
+// O(1) and each key is moved at most once per bit during its lifetime.
+template <class KeyT, class ValueT>
+class radix_heap {
+  static_assert(std::is_integral<KeyT>::value,
+      "radix_heap needs an integer key type");
+
+  public:
+  using value_type = std::pair<KeyT, ValueT>;
+
+  bool empty() const { return _size == 0; }
+  size_t size() const { return _size; }
+
+  void push(KeyT key, const ValueT& value) {
+    size_t b = bucket(ordered(key));
+    _buckets[b].emplace_back(key, value);
+    _size++;
+    if (_top_bucket > 0 && key < _buckets[_top_bucket][_top_pos].first) {
+      _top_bucket = b;
+      _top_pos = _buckets[b].size() - 1;
+    }
+  }
+
+  // smallest key. The heap must not be empty. Does not move the lower bound
+  // on pushed keys, so keys between the last popped one and top() can still
+  // be pushed.
+  const value_type& top() {
+    if (!_buckets[0].empty())
+      return _buckets[0].back();
+    if (_top_bucket == 0)
+      find_top();
+    return _buckets[_top_bucket][_top_pos];
+  }
+
+  void pop() {
+    refill();
+    _buckets[0].pop_back();
+    _size--;
+  }
+
+  void clear() {
+    for (auto& b: _buckets)
+      b.clear();
+    _size = 0;
+    _last = 0;
+    _top_bucket = 0;
+  }
+
+  private:
+  using UKeyT = std::make_unsigned_t<KeyT>;
+  static constexpr size_t bits = std::numeric_limits<UKeyT>::digits;
+
+  std::array<std::vector<value_type>, bits + 1> _buckets;
+  size_t _size = 0;
+  UKeyT _last = 0;
+  // position of the smallest key while bucket 0 is empty, if known
+  size_t _top_bucket = 0, _top_pos = 0;
+
+  // order preserving map of keys to unsigned integers
+  static UKeyT ordered(KeyT key) {
+    if constexpr (std::is_signed<KeyT>::value)
+      return static_cast<UKeyT>(key) ^ (UKeyT(1) << (bits - 1));
+    else
+      return key;
+  }
+
+  // bucket 0 holds keys equal to the last popped key, bucket i > 0 the keys
+  // whose highest bit differing from it is bit i-1
+  size_t bucket(UKeyT key) const {
+    UKeyT diff = key ^ _last;
+    if (diff == 0)
+      return 0;
+    return 64 - (size_t)__builtin_clzll(static_cast<unsigned long long>(diff));
+  }
+
+  void find_top() {
+    size_t i = 1;
+    while (_buckets[i].empty())
+      i++;
+    auto& from = _buckets[i];
+    _top_bucket = i;
+    _top_pos = (size_t)(std::min_element(from.begin(), from.end(),
+          [](const value_type& a, const value_type& b) {
+            return a.first < b.first;
+          }) - from.begin());
+  }
+
+  // moves the smallest keys to bucket 0
+  void refill() {
+    if (!_buckets[0].empty())
+      return;
+
+    if (_top_bucket == 0)
+      find_top();
+    auto& from = _buckets[_top_bucket];
+    _last = ordered(from[_top_pos].first);
+    _top_bucket = 0;
+    // the smallest key moves last, so that it stays on top of bucket 0
+    std::swap(from[_top_pos], from.back());
+    // every key of the bucket lands in a lower bucket
+    for (auto&& kv: from)
+      _buckets[bucket(ordered(kv.first))].push_back(kv);
+    from.clear();
+  }
+};
+
+// Binary min-heap with the interface of radix_heap, for key types that are
+// not integers.
+template <class KeyT, class ValueT>
+class binary_heap {
+  public:
+  using value_type = std::pair<KeyT, ValueT>;
+
+  bool empty() const { return _heap.empty(); }
+  size_t size() const { return _heap.size(); }
+
+  void push(KeyT key, const ValueT& value) {
+    _heap.emplace_back(key, value);
+    std::push_heap(_heap.begin(), _heap.end(), later);
+  }
+
+  const value_type& top() const { return _heap.front(); }
+
+  void pop() {
+    std::pop_heap(_heap.begin(), _heap.end(), later);
+    _heap.pop_back();
+  }
+
+  void clear() { _heap.clear(); }
+
+  private:
+  std::vector<value_type> _heap;
+
+  static bool later(const value_type& a, const value_type& b) {
+    return a.first > b.first;
+  }
+};
+
+// radix_heap for integer keys, binary_heap otherwise
+template <class KeyT, class ValueT>
+using monotone_heap = std::conditional_t<std::is_integral<KeyT>::value,
+      radix_heap<KeyT, ValueT>, binary_heap<KeyT, ValueT>>;
+
+#endif /* RADIX_HEAP_H */
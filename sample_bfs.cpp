@@ -161,6 +161,8 @@ int main(int argc, const char* argv[]) {
         true);
   }
 
+  use_dense_indices(eg);
+
   summary_file << "temporal-vertices: " << eg.node_count() << std::endl;
   summary_file << "temporal-edges: " << eg.event_count() << std::endl;
 
@@ -181,12 +183,13 @@ int main(int argc, const char* argv[]) {
       gen);
 
 
+  out_component_workspace<temp_edge> ws;
   std::size_t out_component_total = 0;
   size_t i = 0;
   for (auto&& root: roots) {
     std::cerr << "sample: " << (i++) << std::endl;
     auto out_component_start = std::clock();
-    auto oc = out_component(eg, root, 0ul, 0ul);
+    auto oc = out_component<EXACT_ESTIMATOR>(eg, root, 0ul, 0ul, ws);
     auto out_component_end = std::clock();
     out_component_total += (size_t)(out_component_end-out_component_start);
   }
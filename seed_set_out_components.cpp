@@ -0,0 +1,290 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+
+#include "cxxopts.hpp"
+
+#pragma GCC diagnostic pop
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+using hll_t = hll::HyperLogLog<18, 19>;
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+double dt_prob_dist(
+    const temp_edge& a, const temp_edge& b, temp_time max_dt) {
+  if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
+    return 1;
+  else
+    return 0;
+}
+
+#include "event_graph.hpp"
+#include "network.hpp"
+#include "measures.hpp"
+#include "out_component_size_estimate.hpp"
+
+cxxopts::Options define_options() {
+  cxxopts::Options options("seed_set_out_components",
+      "union out-components of sets of seed events");
+
+  options.add_options()
+    ("s,seed", "random number generator seed (required)",
+     cxxopts::value<size_t>())
+    ("dt",
+     "delta-t parameter",
+     cxxopts::value<temp_time>()->default_value("1"))
+    ("seeds",
+     "file with one seed set per line, each a list of events in event-list "
+     "format (required)",
+     cxxopts::value<std::string>())
+    ("vertex-seeds",
+     "seed sets list vertices instead, each seeding the first event leaving "
+     "it")
+    ("threads", "number of seed sets processed at once (0 means all "
+     "available)",
+     cxxopts::value<size_t>()->default_value("0"))
+    ("h,help", "Print help")
+    ;
+
+  options.add_options("Event List File")
+    ("temporal-reserve", "estimated size of temporal network",
+     cxxopts::value<size_t>()->default_value("0"))
+    ("n,network", "network in event-list format (required)",
+     cxxopts::value<std::string>())
+    ;
+
+  options.add_options("Output")
+    ("summary", "file to store summary statistics of the network",
+     cxxopts::value<std::string>())
+    ("out-component-sizes",
+     "file to store the union out-component of each seed set (default: "
+     "standard output)",
+     cxxopts::value<std::string>())
+    ;
+  return options;
+}
+
+struct options_t {
+  public:
+    size_t seed;
+
+    bool summary() {
+      return !summary_filename.empty();
+    }
+    std::string summary_filename;
+
+    bool out_component_sizes() {
+      return !out_component_sizes_filename.empty();
+    }
+    std::string out_component_sizes_filename;
+
+    size_t temporal_reserve = 0;
+    std::string network_filename;
+    std::string seeds_filename;
+    bool vertex_seeds = false;
+    size_t threads = 0;
+
+    temp_time dt;
+};
+
+options_t parse_options(int argc, const char* argv[]) {
+  cxxopts::Options option_defs = define_options();
+  auto options = option_defs.parse(argc, argv);
+  options_t opts;
+
+  if (options.count("help") != 0) {
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(0);
+  }
+
+  if (options.count("seed") == 0) {
+    std::cerr << "ERROR: needs a seed argument" << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+  opts.seed = options["seed"].as<size_t>();
+
+  if (options.count("network") == 0) {
+    std::cerr << "ERROR: needs a network argument" << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+  opts.network_filename = options["network"].as<std::string>();
+
+  if (options.count("seeds") == 0) {
+    std::cerr << "ERROR: needs a seeds argument" << std::endl;
+    std::cerr << option_defs.help({"", "Event List File", "Output"})
+      << std::endl;
+    std::exit(1);
+  }
+  opts.seeds_filename = options["seeds"].as<std::string>();
+
+  opts.vertex_seeds = options["vertex-seeds"].as<bool>();
+  opts.threads = options["threads"].as<size_t>();
+
+  if (options.count("temporal-reserve") != 0)
+    opts.temporal_reserve = options["temporal-reserve"].as<size_t>();
+
+  if (options.count("summary") != 0)
+    opts.summary_filename = options["summary"].as<std::string>();
+
+  if (options.count("out-component-sizes") != 0)
+    opts.out_component_sizes_filename =
+      options["out-component-sizes"].as<std::string>();
+
+  opts.dt = options["dt"].as<temp_time>();
+
+  return opts;
+}
+
+// Seed sets of `filename', one per line. Empty lines and lines starting with
+// `#' are skipped. Seeds that are not events of `eg', or vertices that no
+// event leaves, are dropped with a warning.
+std::vector<std::vector<temp_edge>> read_seed_sets(
+    const event_graph<temp_edge>& eg,
+    const std::string& filename, bool vertex_seeds) {
+  std::ifstream file(filename);
+  if (!file) {
+    std::cerr << "ERROR: cannot open " << filename << std::endl;
+    std::exit(1);
+  }
+
+  std::vector<std::vector<temp_edge>> seed_sets;
+  std::string line;
+  size_t line_number = 0, dropped = 0;
+  while (std::getline(file, line)) {
+    line_number++;
+    if (line.find_first_not_of(" \t\r") == std::string::npos ||
+        line[line.find_first_not_of(" \t\r")] == '#')
+      continue;
+
+    std::istringstream items(line);
+    std::vector<temp_edge> seeds;
+    if (vertex_seeds) {
+      temp_vert v;
+      while (items >> v) {
+        auto out = eg.out_incidence().find(v);
+        if (out == eg.out_incidence().end() || out->second.empty())
+          dropped++;
+        else
+          seeds.push_back(out->second.front());
+      }
+    } else {
+      temp_edge e;
+      while (items >> e) {
+        if (std::binary_search(eg.topo().begin(), eg.topo().end(), e))
+          seeds.push_back(e);
+        else
+          dropped++;
+      }
+    }
+    if (!items.eof()) {
+      std::cerr << "ERROR: cannot parse line " << line_number << " of "
+        << filename << std::endl;
+      std::exit(1);
+    }
+    seed_sets.push_back(std::move(seeds));
+  }
+
+  if (dropped > 0)
+    std::cerr << "WARNING: dropped " << dropped << " seeds that are not in "
+      "the network" << std::endl;
+  return seed_sets;
+}
+
+class null_buffer : public std::streambuf {
+  public:
+    int overflow(int c) { return c; }
+};
+
+int main(int argc, const char* argv[]) {
+  options_t opts = parse_options(argc, argv);
+
+  null_buffer null_buf;
+
+  std::ofstream summary_file;
+  if (opts.summary())
+    summary_file.open(opts.summary_filename);
+  else
+    summary_file.basic_ios<char>::rdbuf(&null_buf);
+
+  summary_file << "seed: " << opts.seed << std::endl;
+  summary_file << "dt: " << opts.dt << std::endl;
+
+  event_graph<temp_edge> eg;
+  {
+    std::vector<temp_edge> events = event_list<temp_edge>(
+        opts.network_filename,
+        opts.temporal_reserve);
+
+    eg = event_graph<temp_edge>(
+        events, opts.dt, dt_prob_dist, opts.seed,
+        true);
+  }
+
+  use_dense_indices(eg);
+
+  summary_file << "temporal-vertices: " << eg.node_count() << std::endl;
+  summary_file << "temporal-edges: " << eg.event_count() << std::endl;
+
+  auto seed_sets = read_seed_sets(eg, opts.seeds_filename, opts.vertex_seeds);
+  summary_file << "seed-sets: " << seed_sets.size() << std::endl;
+
+  struct set_row {
+    size_t seeds, events, nodes;
+    temp_time lt_begin, lt_end;
+  };
+  std::vector<set_row> rows(seed_sets.size());
+
+  auto search_start = std::chrono::steady_clock::now();
+  parallel_for(seed_sets.size(), opts.threads,
+      [&eg, &seed_sets, &rows](size_t i, size_t) {
+        auto oc = multi_out_component<EXACT_ESTIMATOR>(eg, seed_sets[i],
+            0ul, 0ul);
+        set_row& row = rows[i];
+        row.seeds = seed_sets[i].size();
+        row.events = oc.edge_set().size();
+        row.nodes = oc.node_set().size();
+        if (row.events > 0)
+          std::tie(row.lt_begin, row.lt_end) = oc.lifetime();
+        else
+          row.lt_begin = row.lt_end = temp_time{};
+      });
+  auto search_end = std::chrono::steady_clock::now();
+  summary_file << "search-wall-time: "
+    << std::chrono::duration<double, std::milli>(
+        search_end-search_start).count()
+    << std::endl;
+  release_bitmap_pools<temp_edge>();
+
+  std::ofstream sizes_file;
+  if (opts.out_component_sizes())
+    sizes_file.open(opts.out_component_sizes_filename);
+  std::ostream& sizes = opts.out_component_sizes() ? sizes_file : std::cout;
+
+  sizes << "# set seeds events nodes lifetime-begin lifetime-end" << std::endl;
+  for (size_t i = 0; i < rows.size(); i++)
+    sizes << i << " " << rows[i].seeds << " " << rows[i].events << " "
+      << rows[i].nodes << " " << rows[i].lt_begin << " " << rows[i].lt_end
+      << std::endl;
+}
@@ -0,0 +1,394 @@
+#ifndef SKETCH_STORE_H
+#define SKETCH_STORE_H
+
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
+#include <fstream>
+#include <utility>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+// HyperLogLog estimate of `m' one-byte registers, with linear counting for
+// small cardinalities
+inline double hll_register_estimate(const uint8_t* registers, size_t m) {
+  double sum = 0;
+  size_t zeros = 0;
+  for (size_t i = 0; i < m; i++) {
+    sum += std::ldexp(1.0, -registers[i]);
+    if (registers[i] == 0)
+      zeros++;
+  }
+  double md = (double)m;
+  double estimate = 0.7213/(1 + 1.079/md)*md*md/sum;
+  if (estimate <= 2.5*md && zeros > 0)
+    estimate = md*std::log(md/(double)zeros);
+  return estimate;
+}
+
+// HyperLogLog sketch with 2^P plain one-byte registers, so that sketches can
+// be written out and merged by other processes. Items are hashed with
+// hll::hash, same as hll_estimator.
+template <typename T, unsigned short P>
+class register_hll_estimator {
+  public:
+  static constexpr size_t register_count = size_t(1) << P;
+
+  register_hll_estimator(uint32_t seed, size_t /*size_est*/)
+    : _seed(seed), _registers(register_count, 0) {}
+
+  double estimate() const {
+    return hll_register_estimate(_registers.data(), register_count);
+  }
+
+  void insert(const T& item) {
+    uint64_t h = hll::hash(item, _seed);
+    size_t idx = (size_t)(h >> (64 - P));
+    uint8_t rank = (uint8_t)(__builtin_clzll(
+          (h << P) | (uint64_t(1) << (P - 1))) + 1);
+    _registers[idx] = std::max(_registers[idx], rank);
+  }
+
+  void merge(const register_hll_estimator<T, P>& other) {
+    for (size_t i = 0; i < register_count; i++)
+      _registers[i] = std::max(_registers[i], other._registers[i]);
+  }
+
+  const std::vector<uint8_t>& registers() const { return _registers; }
+
+  private:
+  uint32_t _seed;
+  std::vector<uint8_t> _registers;
+};
+
+// Sketch of EstimatorT that also keeps a register_hll_estimator<T, P> of the
+// same items, so that a search can run on EstimatorT while the sketches it
+// finishes are written to a sketch store. Estimates and error model are those
+// of EstimatorT, so the search does not depend on whether sketches are stored.
+template <typename T, template<typename> class EstimatorT, unsigned short P>
+class stored_estimator {
+  public:
+  stored_estimator(uint32_t seed, size_t size_est)
+    : _est(seed, size_est), _store(seed, size_est) {}
+
+  double estimate() const { return _est.estimate(); }
+
+  void insert(const T& item) {
+    _est.insert(item);
+    _store.insert(item);
+  }
+
+  void merge(const stored_estimator<T, EstimatorT, P>& other) {
+    _est.merge(other._est);
+    _store.merge(other._store);
+  }
+
+  const EstimatorT<T>& estimator() const { return _est; }
+  const std::vector<uint8_t>& registers() const { return _store.registers(); }
+
+  static double relative_error() { return EstimatorT<T>::relative_error(); }
+
+  static double p_larger(double estimate, size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return EstimatorT<T>::p_larger(estimate, limit, max_size);
+  }
+
+  static std::vector<double> p_larger(const std::vector<double>& estimates,
+      size_t limit,
+      size_t max_size=std::numeric_limits<std::size_t>::max()) {
+    return EstimatorT<T>::p_larger(estimates, limit, max_size);
+  }
+
+  private:
+  EstimatorT<T> _est;
+  register_hll_estimator<T, P> _store;
+};
+
+// ReadOnlyT of the EstimatorT part of a stored_estimator
+template <typename T,
+         template<typename> class EstimatorT,
+         template<typename> class ReadOnlyT,
+         unsigned short P>
+class stored_estimator_readonly : public ReadOnlyT<T> {
+  public:
+  using ReadOnlyT<T>::ReadOnlyT;
+
+  stored_estimator_readonly(const stored_estimator<T, EstimatorT, P>& est)
+    : ReadOnlyT<T>(est.estimator()) {}
+};
+
+
+// Sketch store file: a header, one fixed-size record per stored event and an
+// index of the events sorted by topological order, so a reader can map the
+// file and look events up by binary search.
+//
+//   record: EdgeT event, TimeType lifetime begin and end,
+//           event registers, node registers (2^precision bytes each)
+//   index:  (EdgeT event, uint64_t record number) pairs
+struct sketch_store_header {
+  char magic[8];
+  uint32_t version;
+  uint32_t precision;
+  uint32_t seed;
+  uint32_t event_size;
+  uint32_t time_size;
+  uint32_t reserved;
+  uint64_t count;
+  uint64_t index_offset;
+};
+
+constexpr char sketch_store_magic[8] = {'O', 'C', 'S', 'K', 'E', 'T', 'C', 'H'};
+constexpr uint32_t sketch_store_version = 1;
+constexpr uint32_t sketch_store_min_precision = 4;
+constexpr uint32_t sketch_store_max_precision = 18;
+
+template <class EdgeT>
+struct sketch_store_entry {
+  EdgeT event;
+  uint64_t record;
+};
+
+// Appends the final out-component sketches of events to a sketch store file.
+// Events can be added in any order, each at most once. The index and the
+// header are written by close(), which has to be called explicitly. A writer
+// destroyed without it leaves an incomplete file that readers reject.
+template <class EdgeT, unsigned short P>
+class sketch_store_writer {
+  static_assert(std::is_trivially_copyable<EdgeT>::value,
+      "stored events have to be trivially copyable");
+  static_assert(P >= sketch_store_min_precision &&
+      P <= sketch_store_max_precision,
+      "sketch store precision out of range");
+
+  public:
+  using TimeType = typename EdgeT::TimeType;
+  using VertexType = typename EdgeT::VertexType;
+
+  sketch_store_writer(const std::string& filename, uint32_t seed)
+    : _file(filename, std::ios::binary | std::ios::trunc), _seed(seed) {
+    if (!_file)
+      throw std::runtime_error("cannot open sketch store " + filename);
+    sketch_store_header header = make_header();
+    _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+  }
+
+  // `c' has to be a counter of register_hll_estimator<., P> or
+  // stored_estimator<., ., P> sketches
+  template <class CounterT>
+  void add(const EdgeT& e, const CounterT& c) {
+    _index.push_back(sketch_store_entry<EdgeT>{e, _index.size()});
+    auto lifetime = c.lifetime();
+    write(e);
+    write(lifetime.first);
+    write(lifetime.second);
+    _file.write(reinterpret_cast<const char*>(
+          c.edge_set().registers().data()),
+        (std::streamsize)register_hll_estimator<EdgeT, P>::register_count);
+    _file.write(reinterpret_cast<const char*>(
+          c.node_set().registers().data()),
+        (std::streamsize)register_hll_estimator<VertexType, P>::register_count);
+  }
+
+  size_t size() const { return _index.size(); }
+
+  void close() {
+    std::sort(_index.begin(), _index.end(),
+        [](const sketch_store_entry<EdgeT>& a,
+          const sketch_store_entry<EdgeT>& b) {
+          return a.event < b.event;
+        });
+
+    sketch_store_header header = make_header();
+    header.count = _index.size();
+    header.index_offset = (uint64_t)_file.tellp();
+    for (auto&& entry: _index)
+      write(entry);
+
+    _file.seekp(0);
+    _file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+    _file.close();
+    if (!_file)
+      throw std::runtime_error("cannot write sketch store");
+  }
+
+  private:
+  std::ofstream _file;
+  uint32_t _seed;
+  std::vector<sketch_store_entry<EdgeT>> _index;
+
+  sketch_store_header make_header() const {
+    sketch_store_header header{};
+    std::memcpy(header.magic, sketch_store_magic, sizeof(header.magic));
+    header.version = sketch_store_version;
+    header.precision = P;
+    header.seed = _seed;
+    header.event_size = sizeof(EdgeT);
+    header.time_size = sizeof(TimeType);
+    return header;
+  }
+
+  template <class T>
+  void write(const T& value) {
+    _file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+};
+
+// Read-only view of a memory-mapped sketch store. Union queries only touch
+// the records of the queried events.
+template <class EdgeT>
+class sketch_store_reader {
+  public:
+  using TimeType = typename EdgeT::TimeType;
+
+  struct union_estimate {
+    size_t found = 0;
+    double events = 0, nodes = 0;
+    TimeType lifetime_begin{}, lifetime_end{};
+  };
+
+  explicit sketch_store_reader(const std::string& filename) {
+    _fd = ::open(filename.c_str(), O_RDONLY);
+    if (_fd < 0)
+      throw std::runtime_error("cannot open sketch store " + filename);
+    struct stat st;
+    if (::fstat(_fd, &st) != 0 ||
+        (size_t)st.st_size < sizeof(sketch_store_header)) {
+      ::close(_fd);
+      throw std::runtime_error(filename + " is not a sketch store");
+    }
+    _size = (size_t)st.st_size;
+    void* data = ::mmap(nullptr, _size, PROT_READ, MAP_SHARED, _fd, 0);
+    if (data == MAP_FAILED) {
+      ::close(_fd);
+      throw std::runtime_error("cannot map sketch store " + filename);
+    }
+    _data = static_cast<const uint8_t*>(data);
+    std::memcpy(&_header, _data, sizeof(_header));
+
+    if (!valid_layout()) {
+      unmap();
+      throw std::runtime_error(filename + " is not a sketch store of this "
+          "network type");
+    }
+  }
+
+  sketch_store_reader(const sketch_store_reader&) = delete;
+  sketch_store_reader& operator=(const sketch_store_reader&) = delete;
+
+  ~sketch_store_reader() { unmap(); }
+
+  size_t size() const { return _header.count; }
+  unsigned precision() const { return _header.precision; }
+  uint32_t seed() const { return _header.seed; }
+
+  // estimated union out-component of `events'. Events that are not in the
+  // store are skipped.
+  union_estimate query(const std::vector<EdgeT>& events) const {
+    std::vector<uint8_t> edge_regs(_registers, 0), node_regs(_registers, 0);
+    union_estimate res;
+    for (auto&& e: events) {
+      const uint8_t* rec = find(e);
+      if (!rec)
+        continue;
+
+      TimeType begin, end;
+      std::memcpy(&begin, rec + sizeof(EdgeT), sizeof(TimeType));
+      std::memcpy(&end, rec + sizeof(EdgeT) + sizeof(TimeType),
+          sizeof(TimeType));
+      if (res.found == 0 || begin < res.lifetime_begin)
+        res.lifetime_begin = begin;
+      if (res.found == 0 || res.lifetime_end < end)
+        res.lifetime_end = end;
+      res.found++;
+
+      const uint8_t* regs = rec + sizeof(EdgeT) + 2*sizeof(TimeType);
+      for (size_t i = 0; i < _registers; i++) {
+        edge_regs[i] = std::max(edge_regs[i], regs[i]);
+        node_regs[i] = std::max(node_regs[i], regs[_registers + i]);
+      }
+    }
+
+    if (res.found > 0) {
+      res.events = hll_register_estimate(edge_regs.data(), _registers);
+      res.nodes = hll_register_estimate(node_regs.data(), _registers);
+    }
+    return res;
+  }
+
+  private:
+  int _fd = -1;
+  const uint8_t* _data = nullptr;
+  size_t _size = 0;
+  sketch_store_header _header;
+  size_t _registers = 0, _record_size = 0;
+
+  // checks the header before deriving the record size from it, and that the
+  // records and the index fit in the file without overflowing size_t
+  bool valid_layout() {
+    if (std::memcmp(_header.magic, sketch_store_magic,
+          sizeof(_header.magic)) != 0 ||
+        _header.version != sketch_store_version ||
+        _header.precision < sketch_store_min_precision ||
+        _header.precision > sketch_store_max_precision ||
+        _header.event_size != sizeof(EdgeT) ||
+        _header.time_size != sizeof(TimeType))
+      return false;
+
+    _registers = size_t(1) << _header.precision;
+    _record_size = sizeof(EdgeT) + 2*sizeof(TimeType) + 2*_registers;
+
+    size_t body = _size - sizeof(sketch_store_header);
+    if (_header.count > body/_record_size)
+      return false;
+    size_t records = (size_t)_header.count*_record_size;
+    if (_header.index_offset != sizeof(sketch_store_header) + records)
+      return false;
+    return (_header.count <=
+        (body - records)/sizeof(sketch_store_entry<EdgeT>));
+  }
+
+  void unmap() {
+    if (_data)
+      ::munmap(const_cast<uint8_t*>(_data), _size);
+    if (_fd >= 0)
+      ::close(_fd);
+    _data = nullptr;
+    _fd = -1;
+  }
+
+  const uint8_t* find(const EdgeT& e) const {
+    size_t lo = 0, hi = _header.count;
+    while (lo < hi) {
+      size_t mid = lo + (hi - lo)/2;
+      sketch_store_entry<EdgeT> entry = index_entry(mid);
+      if (entry.event < e)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo == _header.count)
+      return nullptr;
+    sketch_store_entry<EdgeT> entry = index_entry(lo);
+    if (!(entry.event == e) || entry.record >= _header.count)
+      return nullptr;
+    return _data + sizeof(sketch_store_header) + entry.record*_record_size;
+  }
+
+  sketch_store_entry<EdgeT> index_entry(size_t i) const {
+    sketch_store_entry<EdgeT> entry;
+    std::memcpy(&entry, _data + _header.index_offset +
+        i*sizeof(sketch_store_entry<EdgeT>), sizeof(entry));
+    return entry;
+  }
+};
+
+#endif /* SKETCH_STORE_H */
@@ -0,0 +1,207 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <algorithm>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#ifndef HLL_DENSE_PERC
+#pragma message "HLL_DENSE_PERC undefined. Using default definition."
+#define HLL_DENSE_PERC 12
+#endif
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+using hll_t = hll::HyperLogLog<HLL_DENSE_PERC, 19>;
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+#include "measures.hpp"
+
+#include "event_graph.hpp"
+#include "network.hpp"
+#include "out_component_size_estimate.hpp"
+#include "in_component_size_estimate.hpp"
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wconversion"
+
+#include "cxxopts.hpp"
+
+#pragma GCC diagnostic pop
+
+cxxopts::Options define_options() {
+  cxxopts::Options options("stream_in_components",
+      "in-component sizes of a time-ordered event stream read from stdin");
+
+  options.add_options()
+    ("s,seed", "random number generator seed (required)",
+     cxxopts::value<size_t>())
+    ("dt", "maximum dt of the deterministic event graph",
+     cxxopts::value<temp_time>()->default_value("1"))
+    ("report-interval", "number of events between two reports",
+     cxxopts::value<size_t>()->default_value("1000000"))
+    ("quantiles",
+     "comma separated quantiles of the in-component sizes (events) of the "
+     "events of each report interval",
+     cxxopts::value<std::string>()->default_value("0.5,0.9,0.99"))
+    ("h,help", "Print help")
+    ;
+
+  options.add_options("Output")
+    ("reports", "file to store the reports (default: standard output)",
+     cxxopts::value<std::string>())
+    ;
+  return options;
+}
+
+struct options_t {
+  public:
+    size_t seed;
+    uint32_t hll_seed;
+
+    temp_time dt;
+    size_t report_interval;
+    std::vector<double> quantiles;
+
+    bool reports_file() {
+      return !reports_filename.empty();
+    }
+    std::string reports_filename;
+};
+
+options_t parse_options(int argc, const char* argv[]) {
+  cxxopts::Options option_defs = define_options();
+  auto options = option_defs.parse(argc, argv);
+  options_t opts;
+
+  if (options.count("help") != 0) {
+    std::cerr << option_defs.help({"", "Output"}) << std::endl;
+    std::exit(0);
+  }
+
+  if (options.count("seed") == 0) {
+    std::cerr << "ERROR: needs a seed argument" << std::endl;
+    std::cerr << option_defs.help({"", "Output"}) << std::endl;
+    std::exit(1);
+  }
+  opts.seed = options["seed"].as<size_t>();
+  std::mt19937_64 gen(opts.seed);
+  std::uniform_int_distribution<uint32_t> sd;
+  opts.hll_seed = sd(gen);
+
+  opts.dt = options["dt"].as<temp_time>();
+
+  opts.report_interval = std::max<size_t>(1,
+      options["report-interval"].as<size_t>());
+
+  opts.quantiles = parse_list<double>(options["quantiles"].as<std::string>());
+  if (opts.quantiles.empty() ||
+      std::any_of(opts.quantiles.begin(), opts.quantiles.end(),
+        [](double q) { return q < 0 || q > 1; })) {
+    std::cerr << "ERROR: quantiles should be a comma separated list of "
+      "values in [0, 1] range" << std::endl;
+    std::cerr << option_defs.help({"", "Output"}) << std::endl;
+    std::exit(1);
+  }
+
+  if (options.count("reports") != 0)
+    opts.reports_filename = options["reports"].as<std::string>();
+
+  return opts;
+}
+
+
+int main(int argc, const char* argv[]) {
+  options_t opts = parse_options(argc, argv);
+
+  std::ofstream reports_file;
+  if (opts.reports_file())
+    reports_file.open(opts.reports_filename);
+  std::ostream& reports = opts.reports_file() ? reports_file : std::cout;
+
+  reports << "# time events live-vertices live-sketches largest-in-e "
+    "largest-in-g";
+  for (double q: opts.quantiles)
+    reports << " q" << q;
+  reports << std::endl;
+
+  streaming_in_components<temp_edge, hll_estimator> stream(
+      opts.dt, opts.hll_seed);
+
+  size_t event_count = 0;
+  double e_max = 0, g_max = 0;
+  std::vector<double> interval_sizes;
+  interval_sizes.reserve(opts.report_interval);
+
+  auto record = [&](const temp_edge&,
+      const counter<temp_edge, hll_estimator>& comp) {
+    double e = comp.edge_set().estimate();
+    e_max = std::max(e_max, e);
+    g_max = std::max(g_max, comp.node_set().estimate());
+    interval_sizes.push_back(e);
+  };
+
+  auto report = [&](temp_time now) {
+    stream.expire_all(now);
+    reports << now << " " << event_count << " " << stream.live_vertices()
+      << " " << stream.live_sketches() << " " << e_max << " " << g_max;
+    for (double q: opts.quantiles) {
+      double size = 0;
+      if (!interval_sizes.empty()) {
+        auto nth = interval_sizes.begin() + (std::ptrdiff_t)(
+            q*(double)(interval_sizes.size() - 1));
+        std::nth_element(interval_sizes.begin(), nth, interval_sizes.end());
+        size = *nth;
+      }
+      reports << " " << size;
+    }
+    reports << std::endl;
+    interval_sizes.clear();
+  };
+
+  std::vector<temp_edge> same_time;
+  size_t next_report = opts.report_interval;
+
+  auto flush = [&]() {
+    std::sort(same_time.begin(), same_time.end());
+    same_time.erase(std::unique(same_time.begin(), same_time.end()),
+        same_time.end());
+    stream.add_same_time(same_time, record);
+    event_count += same_time.size();
+    if (event_count >= next_report) {
+      report(same_time.front().time);
+      next_report = event_count + opts.report_interval;
+    }
+    same_time.clear();
+  };
+
+  std::ios::sync_with_stdio(false);
+  temp_edge e;
+  while (std::cin >> e) {
+    if (e.v1 == e.v2)
+      continue;
+    if (!same_time.empty() && e.time != same_time.front().time) {
+      if (e.time < same_time.front().time) {
+        std::cerr << "ERROR: events have to be ordered by time" << std::endl;
+        std::exit(1);
+      }
+      flush();
+    }
+    same_time.push_back(e);
+  }
+
+  if (!same_time.empty()) {
+    temp_time last = same_time.front().time;
+    flush();
+    if (!interval_sizes.empty())
+      report(last);
+  }
+}
@@ -0,0 +1,161 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#define HLL_DENSE_PERC 10
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+
+using hll_t = hll::HyperLogLog<HLL_DENSE_PERC, 19>;
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
+    if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
+      return 1;
+    else
+      return 0;
+}
+
+#include "measures.hpp"
+
+
+#include "event_graph.hpp"
+#include "network.hpp"
+#include "out_component_size_estimate.hpp"
+
+
+using bitmap_counter = counter<temp_edge, bitmap_estimator>;
+using exact_counter = counter<temp_edge, exact_estimator>;
+
+// whether `bitmap' holds the same events and vertices as `exact', checked
+// both by index and through the universe mapping
+bool same_sets(const event_graph<temp_edge>& eg,
+    const bitmap_counter& bitmap, const exact_counter& exact) {
+  if (bitmap.edge_set().size() != exact.edge_set().size() ||
+      bitmap.node_set().size() != exact.node_set().size() ||
+      bitmap.lifetime() != exact.lifetime())
+    return false;
+  for (auto&& e: exact.edge_set().set())
+    if (!bitmap.edge_set().contains(e, eg.event_index(e)) ||
+        !bitmap.edge_set().contains(e))
+      return false;
+  for (auto&& v: exact.node_set().set())
+    if (!bitmap.node_set().contains(v, eg.vertex_index(v)) ||
+        !bitmap.node_set().contains(v))
+      return false;
+  return true;
+}
+
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "no input file" << std::endl;
+    return 1;
+  }
+  std::vector<temp_edge> events = event_list<temp_edge>(argv[1], 0);
+
+  size_t mismatches = 0;
+  for (temp_time dt: {2, 10, 72000}) {
+    auto eg = event_graph<temp_edge>(events, dt, dist, 1, true);
+    use_dense_indices(eg);
+
+    // every search after the first runs on bitmaps reused from the pool of
+    // this thread, whether the previous out-component was sparse or dense
+    for (auto&& root: eg.topo()) {
+      auto exact = out_component<exact_estimator>(eg, root, 0, 0);
+      size_t size = exact.edge_set().size();
+      if (!same_sets(eg, out_component<bitmap_estimator>(eg, root, 0, 0),
+            exact) ||
+          !same_sets(eg, out_component<bitmap_estimator>(eg, root, 0, size),
+            exact) ||
+          !same_sets(eg,
+            generic_out_component<bitmap_estimator>(eg, root, 0, 0), exact))
+        mismatches++;
+    }
+
+    // unions of out-components of various sizes, merged into sparse and dense
+    // bitmaps and copies of them
+    const auto& topo = eg.topo();
+    for (size_t first = 0; first < topo.size(); first += 97) {
+      std::vector<temp_edge> roots = {
+        topo[first], topo[(first*7 + 3) % topo.size()],
+        topo[topo.size() - 1 - first/2]};
+
+      auto exact = multi_out_component<exact_estimator>(eg, roots, 0, 0);
+      auto bitmap = multi_out_component<bitmap_estimator>(eg, roots, 0, 0);
+      if (!same_sets(eg, bitmap, exact))
+        mismatches++;
+
+      auto merged = out_component<bitmap_estimator>(eg, roots[2], 0, 0);
+      for (auto&& r: roots) {
+        auto copy = merged;
+        copy.merge(out_component<bitmap_estimator>(eg, r, 0, 0));
+        merged = copy;
+      }
+      if (!same_sets(eg, merged, exact))
+        mismatches++;
+    }
+
+    bitmap_estimator<temp_edge>::release_pool();
+    bitmap_estimator<temp_vert>::release_pool();
+  }
+
+  // sets of random indices within a few words stay sparse, the rest switch to
+  // whole-bitmap passes. Each set reuses the bitmaps of the previous ones.
+  auto eg = event_graph<temp_edge>(events, (temp_time)10, dist, 1, true);
+  use_dense_indices(eg);
+  const auto& topo = eg.topo();
+  std::mt19937_64 gen(1);
+  for (size_t round = 0; round < 200; round++) {
+    size_t span = std::min<size_t>(topo.size(), 64ul << (round % 6));
+    size_t offset = std::uniform_int_distribution<size_t>(
+        0, topo.size() - span)(gen);
+    std::uniform_int_distribution<size_t> index(offset, offset + span - 1);
+
+    bitmap_estimator<temp_edge> a(0, 0), b(0, 0);
+    exact_estimator<temp_edge> exact_a(0, 0), exact_b(0, 0);
+    if (a.size() != 0 || b.size() != 0)
+      mismatches++;
+    for (size_t k = 0; k < 1 + round % 50; k++) {
+      size_t i = index(gen), j = index(gen);
+      a.insert(topo[i], i);
+      exact_a.insert(topo[i]);
+      b.insert(topo[j], j);
+      exact_b.insert(topo[j]);
+    }
+
+    if (round % 2 == 0) {
+      a.merge(b);
+      exact_a.merge(exact_b);
+    } else {
+      b.merge(a);
+      exact_b.merge(exact_a);
+    }
+
+    for (size_t i = 0; i < topo.size(); i++)
+      if (a.contains(topo[i], i) != exact_a.contains(topo[i]) ||
+          b.contains(topo[i], i) != exact_b.contains(topo[i]))
+        mismatches++;
+    if (a.size() != exact_a.size() || b.size() != exact_b.size())
+      mismatches++;
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches
+      << " bitmap out-components or sets differ from the exact ones"
+      << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,151 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <ctime>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#define HLL_DENSE_PERC 10
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+
+using hll_t = hll::HyperLogLog<HLL_DENSE_PERC, 19>;
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+enum class size_measures { events, nodes };
+enum class prob_dist_types { deterministic, exponential };
+
+double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
+    if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
+      return 1;
+    else
+      return 0;
+}
+
+#include "measures.hpp"
+
+
+#include "event_graph.hpp"
+#include "network.hpp"
+#include "opts.hpp"
+#include "out_component_size_estimate.hpp"
+#include "in_component_size_estimate.hpp"
+#include "test_fixtures.hpp"
+
+
+using probabilistic_counter = counter<temp_edge, hll_estimator_readonly>;
+using exact_counter = counter<temp_edge, set_estimator>;
+
+
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "no input file" << std::endl;
+    return 1;
+  }
+  std::vector<temp_edge> events = event_list<temp_edge>(argv[1], 0);
+  auto eg = event_graph<temp_edge>(events, (temp_time)72000, dist, 1, true);
+
+  std::mt19937_64 gen(1);
+  std::uniform_int_distribution<uint32_t> sd;
+  uint32_t hll_seed = sd(gen);
+
+  std::vector<std::pair<temp_edge, exact_counter>>
+    in_comp_ext = in_component_size_estimate<temp_edge, set_estimator, set_estimator>(
+        eg, hll_seed, false);
+
+  sort_by_event(in_comp_ext);
+
+
+  std::vector<std::pair<temp_edge, probabilistic_counter>>
+    in_comp_est = in_component_size_estimate<temp_edge, hll_estimator, hll_estimator_readonly>(
+        eg, hll_seed, false);
+
+  sort_by_event(in_comp_est);
+
+
+  // the stream sees the events of topo() one timestamp at a time
+  std::vector<std::pair<temp_edge, exact_counter>> in_comp_stream;
+  streaming_in_components<temp_edge, set_estimator> stream(
+      (temp_time)72000, hll_seed);
+  auto record = [&in_comp_stream](const temp_edge& e,
+      const exact_counter& comp) {
+    in_comp_stream.emplace_back(e, comp);
+  };
+  std::vector<temp_edge> same_time;
+  for (auto&& e: eg.topo()) {
+    if (!same_time.empty() && e.time != same_time.front().time) {
+      stream.add_same_time(same_time, record);
+      same_time.clear();
+    }
+    same_time.push_back(e);
+  }
+  stream.add_same_time(same_time, record);
+
+  sort_by_event(in_comp_stream);
+
+
+  size_t mismatches = 0, stream_mismatches = 0;
+  if (in_comp_stream.size() != in_comp_ext.size())
+    stream_mismatches++;
+  for (size_t i = 0; i < in_comp_ext.size(); i++) {
+
+    temp_edge e1 = in_comp_est.at(i).first, e2 = in_comp_ext.at(i).first;
+    if (!(e1 == e2))
+      std::cerr << "omgomg" << std::endl;
+
+
+    auto lic_det = deterministic_in_component(eg, e1,
+        (size_t)(in_comp_ext.at(i).second.node_set().estimate()),
+        (size_t)(in_comp_ext.at(i).second.edge_set().estimate()));
+    auto lic_gen = generic_in_component(eg, e1,
+        (size_t)(in_comp_ext.at(i).second.node_set().estimate()),
+        (size_t)(in_comp_ext.at(i).second.edge_set().estimate()));
+
+
+    double edge_count_det = (double)lic_det.edge_set().size();
+    double edge_count_gen = (double)lic_gen.edge_set().size();
+
+    double edge_count_est_sweep = (double)in_comp_est.at(i).second.edge_set().estimate();
+    double edge_count_ext_sweep = (double)in_comp_ext.at(i).second.edge_set().estimate();
+
+    if (edge_count_det != edge_count_gen ||
+        edge_count_det != edge_count_ext_sweep ||
+        lic_det.node_set().size() != lic_gen.node_set().size())
+      mismatches++;
+
+    if (i < in_comp_stream.size() &&
+        (!(in_comp_stream.at(i).first == e2) ||
+         in_comp_stream.at(i).second.edge_set().set() !=
+           in_comp_ext.at(i).second.edge_set().set() ||
+         in_comp_stream.at(i).second.node_set().set() !=
+           in_comp_ext.at(i).second.node_set().set()))
+      stream_mismatches++;
+
+    std::cout
+      << edge_count_det << " " << edge_count_gen << " "
+      << edge_count_est_sweep << " " << edge_count_ext_sweep << std::endl;
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches
+      << " in-components differ between the exact methods" << std::endl;
+    return 1;
+  }
+
+  if (stream_mismatches > 0) {
+    std::cerr << stream_mismatches
+      << " in-components differ between the stream and the sweep"
+      << std::endl;
+    return 1;
+  }
+}
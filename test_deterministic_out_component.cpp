@@ -25,7 +25,7 @@ enum class size_measures { events, nodes };
 enum class prob_dist_types { deterministic, exponential };
 
 double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
-    if (b.time > a.time && b.time - a.time < max_dt)
+    if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
       return 1;
     else
       return 0;
@@ -34,39 +34,23 @@ double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
 #include "measures.hpp"
 
 
-#include "opts.hpp"
 #include "event_graph.hpp"
 #include "network.hpp"
+#include "opts.hpp"
 #include "out_component_size_estimate.hpp"
-
-
-template <typename T>
-class set_estimator {
-  public:
-  set_estimator(uint32_t /*seed*/, size_t size_est) {
-    if (size_est > 0)
-      _set.reserve(size_est);
-  }
-
-  size_t size() const { return _set.size(); }
-  double estimate() const { return (double)size(); }
-
-  void insert(const T& item) { _set.insert(item); }
-
-  void merge(const set_estimator<T>& other) {
-    for (auto&& t: other.set()) insert(t);
-  }
-
-  const std::unordered_set<T>& set() const { return _set; }
-
-  private:
-  std::unordered_set<T> _set;
-};
+#include "sketch_store.hpp"
+#include "test_fixtures.hpp"
 
 
 using probabilistic_counter = counter<temp_edge, hll_estimator_readonly>;
 using exact_counter = counter<temp_edge, set_estimator>;
 
+template <typename T>
+using store_estimator = stored_estimator<T, hll_estimator, 10>;
+template <typename T>
+using store_estimator_readonly =
+  stored_estimator_readonly<T, hll_estimator, hll_estimator_readonly, 10>;
+
 
 
 int main(int argc, const char* argv[]) {
@@ -85,26 +69,32 @@ int main(int argc, const char* argv[]) {
     out_comp_ext = out_component_size_estimate<temp_edge, set_estimator, set_estimator>(
         eg, hll_seed, false);
 
-  std::sort(out_comp_ext.begin(), out_comp_ext.end(),
-      [] (
-        const std::pair<temp_edge, exact_counter>& a,
-        const std::pair<temp_edge, exact_counter>& b) {
-        return a.first < b.first;
-      });
+  sort_by_event(out_comp_ext);
+
+
+  std::vector<std::pair<temp_edge, exact_counter>>
+    out_comp_vs = vertex_state_out_component_size_estimate<temp_edge,
+                set_estimator, set_estimator>(eg, hll_seed, false);
+
+  sort_by_event(out_comp_vs);
+
+
+  std::vector<std::pair<temp_edge, exact_counter>>
+    out_comp_ch = contracted_out_component_size_estimate<temp_edge,
+                set_estimator, set_estimator>(
+                    eg, find_event_chains(eg, 0), hll_seed, false);
+
+  sort_by_event(out_comp_ch);
 
 
   std::vector<std::pair<temp_edge, probabilistic_counter>>
     out_comp_est = out_component_size_estimate<temp_edge, hll_estimator, hll_estimator_readonly>(
         eg, hll_seed, false);
 
-  std::sort(out_comp_est.begin(), out_comp_est.end(),
-      [] (
-        const std::pair<temp_edge, probabilistic_counter>& a,
-        const std::pair<temp_edge, probabilistic_counter>& b) {
-        return a.first < b.first;
-      });
+  sort_by_event(out_comp_est);
 
 
+  size_t mismatches = 0;
   for (size_t i = 0; i < out_comp_ext.size(); i++) {
 
     temp_edge e1 = out_comp_est.at(i).first, e2 = out_comp_ext.at(i).first;
@@ -118,6 +108,12 @@ int main(int argc, const char* argv[]) {
     auto loc_gen = generic_out_component(eg, e1,
         (size_t)(out_comp_ext.at(i).second.node_set().estimate()),
         (size_t)(out_comp_ext.at(i).second.edge_set().estimate()));
+    auto loc_sparse = sparse_deterministic_out_component(eg, e1,
+        (size_t)(out_comp_ext.at(i).second.node_set().estimate()),
+        (size_t)(out_comp_ext.at(i).second.edge_set().estimate()));
+    auto loc_par = parallel_out_component(eg, e1,
+        (size_t)(out_comp_ext.at(i).second.node_set().estimate()),
+        (size_t)(out_comp_ext.at(i).second.edge_set().estimate()), 4);
 
 
     double edge_count_det = (double)loc_det.edge_set().size();
@@ -126,8 +122,102 @@ int main(int argc, const char* argv[]) {
     double edge_count_est_backtrack = (double)out_comp_est.at(i).second.edge_set().estimate();
     double edge_count_ext_backtrack = (double)out_comp_ext.at(i).second.edge_set().estimate();
 
+    if (loc_sparse.edge_set().size() != loc_gen.edge_set().size() ||
+        loc_sparse.node_set().size() != loc_gen.node_set().size() ||
+        loc_det.edge_set().size() != loc_gen.edge_set().size() ||
+        loc_det.node_set().size() != loc_gen.node_set().size() ||
+        loc_par.edge_set().size() != loc_gen.edge_set().size() ||
+        loc_par.node_set().size() != loc_gen.node_set().size())
+      mismatches++;
+
+    if (!(out_comp_vs.at(i).first == e1) ||
+        out_comp_vs.at(i).second.edge_set().estimate() !=
+        edge_count_ext_backtrack ||
+        out_comp_vs.at(i).second.node_set().estimate() !=
+        out_comp_ext.at(i).second.node_set().estimate())
+      mismatches++;
+
+    if (!(out_comp_ch.at(i).first == e1) ||
+        out_comp_ch.at(i).second.edge_set().estimate() !=
+        edge_count_ext_backtrack ||
+        out_comp_ch.at(i).second.node_set().estimate() !=
+        out_comp_ext.at(i).second.node_set().estimate())
+      mismatches++;
+
     std::cout
       << edge_count_det << " " << edge_count_gen << " "
       << edge_count_est_backtrack << " " << edge_count_ext_backtrack << std::endl;
   }
+
+  // sketches of every event, written to a sketch store and read back
+  const std::string store_filename = "test_deterministic_out_component.sketches";
+  sketch_store_writer<temp_edge, 10> writer(store_filename, hll_seed);
+  std::vector<std::pair<temp_edge, counter<temp_edge, store_estimator_readonly>>>
+    out_comp_store = out_component_size_estimate<temp_edge,
+      store_estimator, store_estimator_readonly>(eg, hll_seed, false, {},
+          [&writer](const temp_edge& e,
+            const counter<temp_edge, store_estimator>& c, bool) {
+            writer.add(e, c);
+          });
+  writer.close();
+  sketch_store_reader<temp_edge> store(store_filename);
+  std::remove(store_filename.c_str());
+
+  sort_by_event(out_comp_store);
+
+  // storing sketches does not change the estimates of the sweep, and stored
+  // sketches are within 5 standard errors of a 2^10 register sketch
+  for (size_t i = 0; i < out_comp_store.size(); i++) {
+    auto&& [e, c] = out_comp_store[i];
+    auto res = store.query({e});
+    double events = (double)out_comp_ext.at(i).second.edge_set().size();
+    double nodes = (double)out_comp_ext.at(i).second.node_set().size();
+    if (!(e == out_comp_est.at(i).first) ||
+        c.edge_set().estimate() !=
+        out_comp_est.at(i).second.edge_set().estimate() ||
+        c.node_set().estimate() !=
+        out_comp_est.at(i).second.node_set().estimate() ||
+        res.found != 1 ||
+        std::abs(res.events - events) > 0.17*events + 1 ||
+        std::abs(res.nodes - nodes) > 0.17*nodes + 1 ||
+        res.lifetime_begin != c.lifetime().first ||
+        res.lifetime_end != c.lifetime().second)
+      mismatches++;
+  }
+
+  // union out-components of sets of roots spread over the network
+  size_t n = out_comp_ext.size();
+  for (size_t first = 0; first < n; first += 97) {
+    std::vector<temp_edge> roots = {
+      out_comp_ext[first].first,
+      out_comp_ext[(first*7 + 3) % n].first,
+      out_comp_ext[(first*13 + 5) % n].first};
+
+    auto multi_det = deterministic_multi_out_component(eg, roots, 0, 0);
+    auto multi_gen = generic_multi_out_component(eg, roots, 0, 0);
+    auto multi_union = generic_out_component(eg, roots[0], 0, 0);
+    for (size_t r = 1; r < roots.size(); r++)
+      multi_union.merge(generic_out_component(eg, roots[r], 0, 0));
+
+    if (multi_det.edge_set().size() != multi_union.edge_set().size() ||
+        multi_det.node_set().size() != multi_union.node_set().size() ||
+        multi_gen.edge_set().size() != multi_union.edge_set().size() ||
+        multi_gen.node_set().size() != multi_union.node_set().size())
+      mismatches++;
+
+    // within 5 standard errors of a 2^10 register sketch
+    auto res = store.query(roots);
+    if (res.found != roots.size() ||
+        std::abs(res.events - (double)multi_union.edge_set().size()) >
+          0.17*(double)multi_union.edge_set().size() + 1)
+      mismatches++;
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches
+      << " out-components differ between the sweep and the vertex-state or "
+      "contracted sweeps, or between the search kernels"
+      << std::endl;
+    return 1;
+  }
 }
@@ -0,0 +1,45 @@
+#ifndef TEST_FIXTURES_H
+#define TEST_FIXTURES_H
+
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_set>
+
+// Exact set with the interface of the estimators, so that sweeps can be run
+// with exact counts and compared against the search kernels
+template <typename T>
+class set_estimator {
+  public:
+  set_estimator(uint32_t /*seed*/, size_t size_est) {
+    if (size_est > 0)
+      _set.reserve(size_est);
+  }
+
+  size_t size() const { return _set.size(); }
+  double estimate() const { return (double)size(); }
+
+  void insert(const T& item) { _set.insert(item); }
+
+  void merge(const set_estimator<T>& other) {
+    for (auto&& t: other.set()) insert(t);
+  }
+
+  const std::unordered_set<T>& set() const { return _set; }
+
+  private:
+  std::unordered_set<T> _set;
+};
+
+// sorts the (event, component) results of a sweep by event, so that results
+// of different sweeps line up
+template <class EdgeT, class CounterT>
+void sort_by_event(std::vector<std::pair<EdgeT, CounterT>>& comps) {
+  std::sort(comps.begin(), comps.end(),
+      [](const std::pair<EdgeT, CounterT>& a,
+        const std::pair<EdgeT, CounterT>& b) {
+        return a.first < b.first;
+      });
+}
+
+#endif /* TEST_FIXTURES_H */
@@ -8,21 +8,141 @@ using hll_t = hll::HyperLogLog<10, 20>;
 
 #include "measures.hpp"
 
+double normal_pdf(double x, double mean, double stddev) {
+  constexpr double inv_sqrt_2pi = 0.3989422804014327;
+  double a = (x - mean)/stddev;
+
+  return inv_sqrt_2pi/stddev*std::exp(-0.5*a*a);
+}
+
+// reference implementation summing the posterior over every integer size
+double p_larger_sum(double estimate, size_t limit, size_t max_size,
+    double sigma) {
+
+  if (limit > max_size)
+    return 0.0;
+
+  constexpr double cutoff = 1e-10;
+
+  double p_larger = 0.0;
+  double p_total = 0.0;
+
+  if (estimate < (double)limit*(1-sigma*6))
+    return 0;
+
+  double p_size = normal_pdf(estimate, (double)limit, sigma*(double)limit);
+
+  if (p_size < cutoff) {
+    if (estimate < (double)limit)
+      return 0;
+    else
+      return 1;
+  }
+
+  double min_search = (1 > 6*sigma) ? estimate - 6*sigma*estimate : 1;
+  size_t i = (size_t)min_search;
+  while (i <= limit || (p_size > cutoff && i <= max_size)) {
+
+    p_size = normal_pdf(estimate, (double)i, sigma*(double)i);
+    p_total += p_size;
+    if (i > limit)
+      p_larger += p_size;
+    i++;
+  }
+
+  return p_larger/p_total;
+}
+
 int main(int /*argc*/, const char** /*argv*/) {
   size_t size = 1ul << 14;
+  constexpr double tolerance = 1e-4;
 
-  for (size_t i = 0; i < size; i++) {
+  double sigma = hll_estimator<size_t>::relative_error();
+  std::vector<double> sigmas = {sigma, sigma/4};
 
-    if ((i & (i - 1)) == 0 && i > 32) {
-      // i is a power of two
-      for (size_t j = i-i/2; j < i+i/2; j++)
-        std::cout << j << " ";
-      std::cout << "\n";
+  double max_error = 0.0;
+  size_t compared = 0;
 
-      for (size_t j = i-i/2; j < i+i/2; j++)
-        std::cout << hll_estimator<size_t>::p_larger((double)j, i) << " ";
-      std::cout << "\n";
+  for (double s: sigmas) {
+    for (size_t i = 0; i < size; i++) {
+      if ((i & (i - 1)) == 0 && i > 32) {
+        // i is a power of two
+        std::vector<size_t> max_sizes = {
+          std::numeric_limits<size_t>::max(), i + i/8};
+
+        for (size_t max_size: max_sizes) {
+          std::vector<double> estimates;
+          for (size_t j = i-i/2; j < i+i/2; j++)
+            estimates.push_back((double)j);
+
+          std::vector<double> batch = hll_estimator<size_t>::p_larger(
+              estimates, i, max_size, s);
+
+          for (size_t k = 0; k < estimates.size(); k++) {
+            double expected = p_larger_sum(estimates[k], i, max_size, s);
+            double closed = hll_estimator<size_t>::p_larger(
+                estimates[k], i, max_size, s);
+
+            if (closed != batch[k]) {
+              std::cerr << "batch and single p_larger differ for estimate "
+                << estimates[k] << " limit " << i << std::endl;
+              return 1;
+            }
+
+            max_error = std::max(max_error, std::abs(closed - expected));
+            compared++;
+          }
+        }
+      }
     }
   }
 
+  std::cout << "compared: " << compared << "\n";
+  std::cout << "max-error: " << max_error << "\n";
+
+  if (max_error > tolerance) {
+    std::cerr << "closed-form p_larger differs from the numerical sum by "
+      << max_error << std::endl;
+    return 1;
+  }
+
+  // relative_error() of the ensemble against the spread of its median over
+  // independently seeded ensembles, and the spread within each ensemble
+  // against the error of a single member
+  using ensemble_t = hll_ensemble_estimator<size_t>;
+  using ensemble_readonly_t = hll_ensemble_estimator_readonly<size_t>;
+  constexpr size_t trials = 400, set_size = 20000;
+  double sum_sq_median = 0.0, sum_member_error = 0.0;
+  for (uint32_t seed = 0; seed < trials; seed++) {
+    ensemble_t ens(seed, 0);
+    for (size_t i = 0; i < set_size; i++)
+      ens.insert(i);
+    ensemble_readonly_t ro(ens);
+
+    if (ro.estimate() != ensemble_t::median(ro.estimates()) ||
+        ro.estimate() != ens.estimate()) {
+      std::cerr << "ensemble median differs from its read-only copy"
+        << std::endl;
+      return 1;
+    }
+
+    double err = ro.estimate()/(double)set_size - 1.0;
+    sum_sq_median += err*err;
+    sum_member_error += ro.stddev()/ro.mean();
+  }
+  double median_error = std::sqrt(sum_sq_median/(double)trials);
+  double member_error = sum_member_error/(double)trials;
+
+  std::cout << "ensemble-relative-error: " << ensemble_t::relative_error()
+    << " measured: " << median_error << "\n";
+  std::cout << "member-relative-error: " << hll_estimator<size_t>::relative_error()
+    << " measured: " << member_error << "\n";
+
+  if (std::abs(median_error/ensemble_t::relative_error() - 1.0) > 0.3 ||
+      std::abs(member_error/hll_estimator<size_t>::relative_error() - 1.0) >
+      0.3) {
+    std::cerr << "ensemble spread does not match relative_error()"
+      << std::endl;
+    return 1;
+  }
 }
@@ -0,0 +1,122 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <ctime>
+#include <chrono>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#define HLL_DENSE_PERC 10
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::directed_temporal_network<uint32_t, double>
+#endif
+
+
+using hll_t = hll::HyperLogLog<HLL_DENSE_PERC, 19>;
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+enum class size_measures { events, nodes };
+enum class prob_dist_types { deterministic, exponential };
+
+double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
+    if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
+      return 1;
+    else
+      return 0;
+}
+
+#include "measures.hpp"
+
+
+#include "event_graph.hpp"
+#include "network.hpp"
+#include "opts.hpp"
+#include "out_component_size_estimate.hpp"
+#include "test_fixtures.hpp"
+
+
+size_t link_count(const event_graph<temp_edge>& eg) {
+  size_t links = 0, reverse_links = 0;
+  for (auto&& e: eg.topo()) {
+    links += eg.successors(e).size();
+    reverse_links += eg.predecessors(e).size();
+  }
+  if (links != reverse_links)
+    std::cerr << "successors and predecessors disagree: " << links << " and "
+      << reverse_links << " links" << std::endl;
+  return links;
+}
+
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "no input file" << std::endl;
+    return 1;
+  }
+  std::vector<temp_edge> events = event_list<temp_edge>(argv[1], 0);
+  auto eg = event_graph<temp_edge>(events, (temp_time)72000, dist, 1, true);
+  auto reduction_start = std::chrono::steady_clock::now();
+  auto reduced_eg = eg.with_transitive_reduction();
+  auto reduction_end = std::chrono::steady_clock::now();
+
+  size_t links = link_count(eg);
+  size_t reduced_links = link_count(reduced_eg);
+
+  std::mt19937_64 gen(1);
+  std::uniform_int_distribution<uint32_t> sd;
+  uint32_t hll_seed = sd(gen);
+
+  auto sweep_start = std::chrono::steady_clock::now();
+  auto out_comp = out_component_size_estimate<temp_edge,
+       set_estimator, set_estimator>(eg, hll_seed, false);
+  auto sweep_end = std::chrono::steady_clock::now();
+  auto reduced_out_comp = out_component_size_estimate<temp_edge,
+       set_estimator, set_estimator>(reduced_eg, hll_seed, false);
+  auto reduced_sweep_end = std::chrono::steady_clock::now();
+
+  // the reduced sweep time includes computing the reduction
+  auto ms = [](auto start, auto end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+  };
+  std::cout << "links: " << links << " sweep-ms: "
+    << ms(sweep_start, sweep_end) << std::endl;
+  std::cout << "reduced-links: " << reduced_links << " sweep-ms: "
+    << ms(reduction_start, reduction_end) +
+       ms(sweep_end, reduced_sweep_end)
+    << " reduction-ms: " << ms(reduction_start, reduction_end) << std::endl;
+
+  sort_by_event(out_comp);
+  sort_by_event(reduced_out_comp);
+
+  size_t mismatches = 0;
+  if (out_comp.size() != reduced_out_comp.size())
+    mismatches++;
+  for (size_t i = 0; i < std::min(out_comp.size(),
+        reduced_out_comp.size()); i++) {
+    auto loc_gen = generic_out_component(reduced_eg, out_comp[i].first,
+        (size_t)(out_comp[i].second.node_set().estimate()),
+        (size_t)(out_comp[i].second.edge_set().estimate()));
+
+    double edge_count = out_comp[i].second.edge_set().estimate();
+    if (!(out_comp[i].first == reduced_out_comp[i].first) ||
+        edge_count != reduced_out_comp[i].second.edge_set().estimate() ||
+        edge_count != (double)loc_gen.edge_set().size() ||
+        out_comp[i].second.node_set().estimate() !=
+        reduced_out_comp[i].second.node_set().estimate())
+      mismatches++;
+  }
+
+  if (links < reduced_links || mismatches > 0) {
+    std::cerr << mismatches
+      << " out-components differ between the full and the reduced event graph"
+      << std::endl;
+    return 1;
+  }
+}
@@ -0,0 +1,204 @@
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <random>
+
+#include <hyperloglog.hpp>
+#include <dag.hpp>
+
+#ifndef NETWORK_TYPE
+#pragma message "NETWORK_TYPE undefined. Using default definition."
+#define NETWORK_TYPE dag::undirected_temporal_network<uint32_t, double>
+#endif
+
+
+using temp_net = NETWORK_TYPE;
+using temp_vert = typename temp_net::VertexType;
+using temp_edge = typename temp_net::EdgeType;
+using temp_time = typename temp_edge::TimeType;
+
+double dist(const temp_edge& a, const temp_edge& b, temp_time max_dt) {
+    if (b.time > a.effect_time() && b.time - a.effect_time() < max_dt)
+      return 1;
+    else
+      return 0;
+}
+
+#include "event_graph.hpp"
+#include "network.hpp"
+
+
+constexpr size_t npos = std::numeric_limits<size_t>::max();
+
+// component id of every event in topo() order from a breadth-first search
+// over successors and predecessors, the id being the index of the earliest
+// event of the component
+std::vector<size_t> bfs_component_ids(const event_graph<temp_edge>& eg) {
+  const auto& topo = eg.topo();
+  std::vector<size_t> ids(topo.size(), npos);
+  std::vector<size_t> queue;
+  for (size_t root = 0; root < topo.size(); root++) {
+    if (ids[root] != npos)
+      continue;
+    ids[root] = root;
+    queue.assign(1, root);
+    while (!queue.empty()) {
+      size_t i = queue.back();
+      queue.pop_back();
+      for (auto&& links: {eg.successors(topo[i]), eg.predecessors(topo[i])})
+        for (auto&& other: links) {
+          size_t j = eg.event_index(other);
+          if (ids[j] == npos) {
+            ids[j] = root;
+            queue.push_back(j);
+          }
+        }
+    }
+  }
+  return ids;
+}
+
+// smallest element of the set of every element of [0, n) after merging
+// `pairs' one at a time
+std::vector<size_t> serial_component_ids(size_t n,
+    const std::vector<std::pair<size_t, size_t>>& pairs) {
+  std::vector<size_t> parent(n);
+  for (size_t i = 0; i < n; i++)
+    parent[i] = i;
+  auto find = [&parent](size_t i) {
+    while (parent[i] != i)
+      i = parent[i] = parent[parent[i]];
+    return i;
+  };
+  for (auto&& [a, b]: pairs) {
+    size_t ra = find(a), rb = find(b);
+    if (ra != rb)
+      parent[std::max(ra, rb)] = std::min(ra, rb);
+  }
+  std::vector<size_t> ids(n);
+  for (size_t i = 0; i < n; i++)
+    ids[i] = find(i);
+  return ids;
+}
+
+// number of elements whose concurrent_disjoint_set id differs from `ids',
+// with the ids read on `threads' threads at once
+size_t id_mismatches(concurrent_disjoint_set& disj_set,
+    const std::vector<size_t>& ids, size_t threads) {
+  std::vector<size_t> found(ids.size());
+  parallel_for(ids.size(), threads,
+      [&found, &disj_set](size_t i, size_t) {
+        found[i] = disj_set.component_id(i);
+      });
+  size_t mismatches = 0;
+  for (size_t i = 0; i < ids.size(); i++)
+    if (found[i] != ids[i])
+      mismatches++;
+  return mismatches;
+}
+
+
+int main(int argc, const char* argv[]) {
+  if (argc < 2) {
+    std::cout << "no input file" << std::endl;
+    return 1;
+  }
+
+  const std::vector<size_t> thread_counts = {1, 2, 4, 8};
+  size_t mismatches = 0;
+
+  // a single chain i -> i-1, with every element found at once, so that the
+  // path splitting of concurrent finds races on the same links
+  constexpr size_t chain_size = 1ul << 16;
+  for (size_t threads: thread_counts)
+    for (size_t round = 0; round < 8; round++) {
+      concurrent_disjoint_set chain(chain_size);
+      for (size_t i = chain_size - 1; i > 0; i--)
+        chain.merge(i - 1, i);
+      mismatches += id_mismatches(chain,
+          std::vector<size_t>(chain_size, 0), threads);
+    }
+
+  // random merges and finds on `threads' threads at once
+  std::mt19937_64 gen(1);
+  constexpr size_t random_size = 1ul << 16;
+  std::uniform_int_distribution<size_t> element(0, random_size - 1);
+  for (size_t threads: thread_counts) {
+    std::vector<std::pair<size_t, size_t>> pairs(random_size/2);
+    for (auto&& p: pairs)
+      p = {element(gen), element(gen)};
+
+    concurrent_disjoint_set random_set(random_size);
+    parallel_for(pairs.size(), threads,
+        [&random_set, &pairs](size_t i, size_t) {
+          random_set.merge(pairs[i].first, pairs[i].second);
+        });
+    mismatches += id_mismatches(random_set,
+        serial_component_ids(random_size, pairs), threads);
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches
+      << " concurrent_disjoint_set ids differ from the serial ones"
+      << std::endl;
+    return 1;
+  }
+
+  std::vector<temp_edge> events = event_list<temp_edge>(argv[1], 0);
+  auto eg = event_graph<temp_edge>(events, (temp_time)1, dist, 1, true);
+
+  size_t deterministic_mismatches = 0;
+
+  for (temp_time dt: {1, 2, 5, 10, 30, 72000}) {
+    auto dt_eg = eg.with_expected_dt(dt);
+    auto bfs_ids = bfs_component_ids(dt_eg);
+
+    size_t components = 0;
+    for (size_t i = 0; i < bfs_ids.size(); i++)
+      if (bfs_ids[i] == i)
+        components++;
+    std::cout << "dt: " << dt << " components: " << components << std::endl;
+
+    for (size_t threads: thread_counts) {
+      if (weakly_connected_component_ids(dt_eg, threads) != bfs_ids)
+        mismatches++;
+      if (deterministic_weakly_connected_component_ids(dt_eg, threads)
+          != bfs_ids)
+        deterministic_mismatches++;
+    }
+  }
+
+  if (mismatches > 0) {
+    std::cerr << mismatches
+      << " weakly connected component ids differ from the search"
+      << std::endl;
+    return 1;
+  }
+
+  if (deterministic_mismatches > 0) {
+    std::cerr << deterministic_mismatches
+      << " deterministic weakly connected component ids differ from the search"
+      << std::endl;
+    return 1;
+  }
+
+  // components from one pass over the link gaps, checked against components
+  // of the event graph for every dt
+  size_t percolation_mismatches = 0, percolation_dts = 0;
+  dt_percolation_ids(eg, {72000, 30, 10, 5, 2, 1}, 4,
+      [&eg, &percolation_mismatches, &percolation_dts](temp_time dt,
+        const std::vector<size_t>& ids, size_t count) {
+        auto expected = deterministic_weakly_connected_component_ids(
+            eg.with_expected_dt(dt), 1);
+        if (compact_component_ids(expected) != count || expected != ids)
+          percolation_mismatches++;
+        percolation_dts++;
+      });
+
+  if (percolation_mismatches > 0 || percolation_dts != 6) {
+    std::cerr << percolation_mismatches
+      << " dt percolation components differ from the event graph"
+      << std::endl;
+    return 1;
+  }
+}